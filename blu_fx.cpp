@@ -18,6 +18,11 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#if IBM
+#include <winsock2.h>       /* must come before windows.h, which is included by XPLMDefs.h */
+#include <ws2tcpip.h>
+#endif
+
 #include "XPLMDataAccess.h"
 #include "XPLMDefs.h"
 
@@ -33,14 +38,41 @@
 #include "XPStandardWidgets.h"
 #include "XPWidgets.h"
 
+#include "blu_fx_log.h"
+#include "blu_fx_pacer.h"
+#include "blu_fx_remote.h"
+#include "blu_fx_ui.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <limits.h>
+#include <math.h>
 
 #if !IBM
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
 #include <unistd.h>
 #endif
 
+#if APL
+#include <dlfcn.h>
+#endif
+
+#if LIN
+#include <dirent.h>
+#endif
+
 #if APL
 #include <OpenGL/gl.h>
 #elif IBM
@@ -48,6 +80,7 @@
 #pragma comment( lib, "winmm.lib")   
 #elif LIN
 #include <GL/gl.h>
+#include <GL/glx.h>
 #endif
 
 // define name
@@ -90,12 +123,48 @@
 #define CONFIG_PATH "./Resources/plugins/" NAME_LOWERCASE "/" NAME_LOWERCASE ".ini"
 #endif
 
+// define preset library path (relative to the X-Plane system path), which holds one small .ini-style file per preset
+#if IBM
+#define PRESETS_PATH "Resources\\plugins\\" NAME_LOWERCASE "\\presets"
+#else
+#define PRESETS_PATH "Resources/plugins/" NAME_LOWERCASE "/presets"
+#endif
+#define PRESET_FILE_EXTENSION ".ini"
+#define PRESET_PAGE_SIZE 18      /* number of catalog buttons shown per page (two columns) */
+#define PRESET_FINGERPRINT_STEP 0.001f  /* values closer than this (finer than any slider) match */
+
 #define DEFAULT_POST_PROCESSING_ENABLED 1
 #define DEFAULT_FPS_LIMITER_ENABLED 0
 #define DEFAULT_CONTROL_CINEMA_VERITE_ENABLED 0 /* was 1 by default in 32-bit version */
 #define DEFAULT_RALEIGH_SCALE 13.0f
 #define DEFAULT_MAX_FRAME_RATE 30.0f
 #define DEFAULT_DISABLE_CINEMA_VERITE_TIME 5.0f
+#define DEFAULT_TRANSITION_TIME 1.0f
+#define DEFAULT_ADAPTIVE_FPS_ENABLED 0
+#define DEFAULT_REFRESH_RATE 60.0f
+#define DEFAULT_PAUSED_FPS 0.0f         /* 0 = no cap while paused */
+#define DEFAULT_REPLAY_FPS 0.0f         /* 0 = no cap in replay */
+#define DEFAULT_BATTERY_FPS 0.0f        /* 0 = no cap on battery (Linux only) */
+#define DEFAULT_HOT_FPS 0.0f            /* 0 = no cap when hot (Linux only) */
+#define DEFAULT_HOT_TEMPERATURE 90.0f
+#define DEFAULT_POWER_SYSFS_ROOT "/sys"
+#define DEFAULT_LOW_LATENCY_FRAMES 0    /* 0 = off, else the number of frames the GPU may lag behind (1 or 2) */
+#define DEFAULT_MODERN_SETTINGS_WINDOW 0    /* 1 = immediate-mode settings window (blu_fx_ui.h) instead of the widgets */
+#define DEFAULT_PRESET_THUMBNAILS 0     /* 1 = the immediate-mode settings window shows the presets as thumbnails */
+#define DEFAULT_COMPARE_MODE COMPARE_SPLIT  /* ungraded left half while the settings window is open, as before */
+#define DEFAULT_COMPARE_SPLIT 0.5f      /* fraction of the screen width */
+#define DEFAULT_LOG_LEVEL LOG_INFO      /* see BLUfxLogLevels_t in blu_fx_log.h, 0 = debug ... 3 = errors only */
+
+// size of the immediate-mode settings window in boxels (the Raleigh section only exists before XP12)
+#define SETTINGS_WINDOW_WIDTH 420
+#define SETTINGS_WINDOW_HEIGHT 822
+#define SETTINGS_WINDOW_RALEIGH_HEIGHT 70
+#define SETTINGS_WINDOW_THUMBNAILS_HEIGHT (THUMBNAIL_ROWS * (THUMBNAIL_TILE_HEIGHT + 4) - PRESET_PAGE_SIZE / 2 * UI_ROW_HEIGHT)
+#define DEFAULT_REMOTE_CONTROL_ENABLED 0
+#define DEFAULT_REMOTE_CONTROL_PORT 49590
+#define DEFAULT_SYNC_MODE SYNC_OFF
+#define DEFAULT_SYNC_GROUP "239.255.70.88"
+#define DEFAULT_SYNC_PORT 49591
 
 enum BLUfxPresets_t
 {
@@ -122,6 +191,22 @@ enum BLUfxPresets_t
     PRESET_MAX
 };
 
+// grading parameters of the post-processing pass, in the same order as the first members of BLUfxPreset_t
+enum BLUfxParams_t
+{
+    PARAM_BRIGHTNESS = 0,
+    PARAM_CONTRAST,
+    PARAM_SATURATION,
+    PARAM_RED_SCALE,
+    PARAM_GREEN_SCALE,
+    PARAM_BLUE_SCALE,
+    PARAM_RED_OFFSET,
+    PARAM_GREEN_OFFSET,
+    PARAM_BLUE_OFFSET,
+    PARAM_VIGNETTE,
+    PARAM_MAX
+};
+
 struct BLUfxPreset_t
 {
     // basic
@@ -144,6 +229,14 @@ struct BLUfxPreset_t
 };
 typedef BLUfxPreset_t BLUfxPreset;
 
+// returns the grading parameters of a preset as a vector indexed by BLUfxParams_t
+static inline const float *PresetParams(const BLUfxPreset *preset)
+{
+    return &preset->brightness;
+}
+static_assert(offsetof(BLUfxPreset_t, vignette) == PARAM_VIGNETTE * sizeof(float), "BLUfxPreset_t must start with the PARAM_MAX grading parameters");
+static_assert(offsetof(BLUfxPreset_t, disableCinemaVeriteTime) == (PARAM_MAX + 2) * sizeof(float), "BLUfxPreset_t must be a vector of floats");
+
 BLUfxPreset BLUfxPresets [PRESET_MAX] =
 {
     // PRESET_USER (scratchpad; looks like default, but read from .ini)
@@ -469,9 +562,239 @@ BLUfxPreset BLUfxPresets [PRESET_MAX] =
     }
 };
 
-// fragment-shader code
+// display names of the built-in presets (as shown in the preset catalog)
+static const char *BLUfxPresetNames [PRESET_MAX] =
+{
+    "Restore",
+    "Reset",
+    "Polaroid",
+    "Fogged Up",
+    "High Dynamic Range",
+    "Editor's Choice",
+    "Slightly Enhanced",
+    "Extra Gloomy",
+    "Red-ish",
+    "Green-ish",
+    "Blue-ish",
+    "Shiny California",
+    "Dusty Dry",
+    "Gray Winter",
+    "Fancy Imagination",
+    "Sixties",
+    "Cold Winter",
+    "Vintage Film",
+    "Colorless",
+    "Monochrome"
+};
+
+// entry of the preset catalog, which holds the built-in presets (read-only) as well as the ones found in PRESETS_PATH:
+// on startup only the name and metadata of on-disk presets are indexed, the values are loaded when first selected
+struct BLUfxCatalogEntry_t
+{
+    std::string name;
+    std::string author;
+    std::string path;           // empty for built-in presets
+    bool loaded;                // false until the preset values have been read from path
+    BLUfxPreset preset;
+    uint64_t fingerprint;       // PresetFingerprint of preset, once loaded
+};
+typedef BLUfxCatalogEntry_t BLUfxCatalogEntry;
+
+// frame-time statistics: the times of the last FRAME_STATS_WINDOW frames are kept in a ring buffer and, for the
+// percentiles, in a histogram of FRAME_STATS_BIN_WIDTH ms bins (the last bin collects all longer frames), so that
+// recording a frame never allocates and the percentiles follow by moving a cursor over a few bins
+#define FRAME_STATS_WINDOW 1024
+#define FRAME_STATS_BINS 1000
+#define FRAME_STATS_BIN_WIDTH 0.1f
+#define FRAME_STATS_MAX_FRAME_TIME 1000.0f      /* longer frames (loading, dialogs) are not counted */
+#define FRAME_STATS_PERCENTILES 4
+
+// statistics published as datarefs (blu_fx/stats/...), all over the rolling window
+enum BLUfxStats_t
+{
+    STAT_FRAME_TIME_P50,
+    STAT_FRAME_TIME_P90,
+    STAT_FRAME_TIME_P95,
+    STAT_FRAME_TIME_P99,
+    STAT_FPS_AVERAGE,
+    STAT_FPS_1_PERCENT_LOW,
+    STAT_MAX
+};
+
+// a percentile of the frame-time histogram, tracked as the bin that contains it and the number of frames below that bin
+struct BLUfxPercentile_t
+{
+    float fraction;
+    int bin;
+    int below;
+};
+typedef BLUfxPercentile_t BLUfxPercentile;
+
+// frame-time statistics of the rolling window and of the whole session, written by the sim thread only
+struct BLUfxFrameStats_t
+{
+    float frameTimes[FRAME_STATS_WINDOW];       // ring buffer, in ms
+    int next, count;
+    double sum;
+    unsigned short bins[FRAME_STATS_BINS];
+    double binSums[FRAME_STATS_BINS];           // sum of the frame times in each bin, for the 1% low
+    BLUfxPercentile percentiles[FRAME_STATS_PERCENTILES];   // p50, p90, p95, p99 (in the order of BLUfxStats_t)
+    unsigned int sessionBins[FRAME_STATS_BINS];
+    long sessionFrames;
+    double sessionSum, sessionMax;
+    double lastFrameStart;                      // monotonic time of the previous frame (0 = none yet)
+};
+typedef BLUfxFrameStats_t BLUfxFrameStats;
+
+// adaptive frame-rate cap: once per ADAPTIVE_FPS_INTERVAL seconds the cap is set to the highest divisor of the refresh
+// rate (but at most maxFps) that the p90 of the unconstrained frame times (without the limiter's sleep) can sustain;
+// it drops right away when the machine falls behind, but is only raised after the next step has been sustainable with
+// ADAPTIVE_FPS_HEADROOM to spare for ADAPTIVE_FPS_RAISE_INTERVALS evaluations in a row, so that it doesn't oscillate
+#define ADAPTIVE_FPS_INTERVAL 1.0
+#define ADAPTIVE_FPS_MIN_FRAMES 120
+#define ADAPTIVE_FPS_HEADROOM 1.1f
+#define ADAPTIVE_FPS_RAISE_INTERVALS 5
+#define ADAPTIVE_FPS_MIN_FPS 20.0f
+#define MIN_REFRESH_RATE 24.0f          /* limits of refreshRate in blu_fx.ini */
+#define MAX_REFRESH_RATE 500.0f
+
+// states of the sim that can have a frame-rate cap of their own, polled every SIM_CONTEXT_POLL_INTERVAL seconds
+enum BLUfxSimContexts_t
+{
+    SIM_CONTEXT_FLYING,
+    SIM_CONTEXT_PAUSED,
+    SIM_CONTEXT_REPLAY
+};
+
+#define SIM_CONTEXT_POLL_INTERVAL 0.5f
+
+// the layout of the fake window and the settings widget is only recomputed when the screen size or the bounds of the
+// monitors change (the latter has no message, so it is polled every SCREEN_BOUNDS_POLL_INTERVAL seconds), when an
+// aircraft is loaded and when the settings widget was shown or has been dragged
+#define SCREEN_BOUNDS_POLL_INTERVAL 1.0f
+
+// cinema verite control: cinema verite is switched off while the mouse is used in the 3D cockpit and back on once it
+// has been idle for disableCinemaVeriteTime seconds (one-shot timer), the datarefs are only written on transitions;
+// X-Plane 12 has separate datarefs for interior and exterior views (probed at startup), with the single legacy
+// dataref the view type is polled every CINEMA_VERITE_VIEW_POLL_INTERVAL seconds instead
+#define CINEMA_VERITE_VIEW_POLL_INTERVAL 0.25f
+#define CINEMA_VERITE_INTERIOR_DATAREF "sim/graphics/view/cinema_verite_interior"
+#define CINEMA_VERITE_EXTERIOR_DATAREF "sim/graphics/view/cinema_verite_exterior"
+#define VIEW_TYPE_3D_COCKPIT 1026
+
+// tasks of the scheduler flightloop, in the order in which they run within a frame
+enum BLUfxTasks_t
+{
+    TASK_LIMITER,
+    TASK_FRAME_STATE,
+    TASK_FRAME_STATS,
+    TASK_SIM_CONTEXT,
+    TASK_REMOTE_MAILBOX,
+    TASK_SYNC_MASTER,
+    TASK_SCREEN_BOUNDS,
+    TASK_LAYOUT,
+    TASK_CONTROL_CINEMA_VERITE,
+    TASK_LOG,
+    TASK_MAX
+};
+
+// a task of the scheduler, which runs every everyFrames frames or, if everySeconds is set, every everySeconds seconds
+// while it is active, and keeps track of its own run time
+struct BLUfxTask_t
+{
+    const char *name;
+    void (*run)(void);
+    int everyFrames;
+    float everySeconds;
+    int active;
+    int framesLeft;             // until the next run
+    double nextTime;            // of the next run, if everySeconds is set
+    long runs;
+    double runTimeSum, runTimeMax;
+};
+typedef BLUfxTask_t BLUfxTask;
+
+// snapshot of the sim state that is needed every frame, read once per frame by the frame state task (right after the
+// limiter's sleep) and shared by all callbacks of that frame instead of each of them asking X-Plane again; values that
+// are only needed at a lower rate (view type, pause and replay) are read by the tasks that poll them
+struct BLUfxFrameState_t
+{
+    long frame;
+    float elapsedTime;          // XPLMGetElapsedTime
+    int screenWidth, screenHeight;
+    int settingsWindowOpen;
+    int xplmCalls;              // XPLM and widget calls made by BLU-fx during the previous frame
+};
+typedef BLUfxFrameState_t BLUfxFrameState;
+
+// counts a call into X-Plane made while flying (wrap every per-frame or periodic XPLM call in this)
+#define XPLM_CALL(call) (xplmCallCount++, (call))
+
+// a dataref of X-Plane or of another plugin, looked up by name through the binding table
+struct BLUfxDataRefBinding_t
+{
+    const char *name;
+    XPLMDataRef *dataRef;
+};
+typedef BLUfxDataRefBinding_t BLUfxDataRefBinding;
+
+// host power state, read from sysfs (power_supply and thermal zones) by a background thread on Linux
+#define POWER_ON_BATTERY 1
+#define POWER_HOT 2
+#define POWER_POLL_INTERVAL 5000        /* ms */
+#define POWER_HOT_HYSTERESIS 5.0f       /* degrees C below the hot temperature to be considered cool again */
+
+// compare modes of the post-processing pass while the settings window is open: the ungraded scene left of the split,
+// the grade of a reference (the "B" side) left of the split, or the difference of the grade to the ungraded scene
+enum BLUfxCompareModes_t
+{
+    COMPARE_OFF = 0,
+    COMPARE_SPLIT,
+    COMPARE_PRESETS,
+    COMPARE_DIFFERENCE,
+    COMPARE_MAX
+};
+#define COMPARE_DIFFERENCE_GAIN 4.0     /* the difference is amplified to be visible */
+#define COMPARE_GRAB_DISTANCE 8         /* boxels from the split within which it can be dragged on screen */
+
+#define SHADER_STRING(x) #x
+#define SHADER_NUMBER(x) SHADER_STRING(x)
+
+// shader code of the grade, shared by the post-processing pass and the preset thumbnails: grade takes the grading
+// parameters (named like the members of BLUfxPreset_t) except for the vignette, which is applied by vignetted at a
+// position relative to the center of the screen, and gradeWith takes all of them as 3 vec4s (the order of BLUfxParams_t)
+#define GRADE_SHADER_FUNCTIONS "const vec3 lumCoeff = vec3(0.2125, 0.7154, 0.0721);"\
+                               "vec3 grade(vec3 color, float brightness, float contrast, float saturation, float redScale, float greenScale, float blueScale, float redOffset, float greenOffset, float blueOffset)"\
+                               "{"\
+                                   "color *= contrast;"\
+                                   "color += vec3(brightness, brightness, brightness);"\
+                                   "vec3 intensity = vec3(dot(color, lumCoeff));"\
+                                   "color = mix(intensity, color, saturation);"\
+                                   "vec3 newColor = (color.rgb - 0.5) * 2.0;"\
+                                   "newColor.r = 2.0 / 3.0 * (1.0 - (newColor.r * newColor.r));"\
+                                   "newColor.g = 2.0 / 3.0 * (1.0 - (newColor.g * newColor.g));"\
+                                   "newColor.b = 2.0 / 3.0 * (1.0 - (newColor.b * newColor.b));"\
+                                   "newColor.r = clamp(color.r + redScale * newColor.r + redOffset, 0.0, 1.0);"\
+                                   "newColor.g = clamp(color.g + greenScale * newColor.g + greenOffset, 0.0, 1.0);"\
+                                   "newColor.b = clamp(color.b + blueScale * newColor.b + blueOffset, 0.0, 1.0);"\
+                                   "return newColor;"\
+                               "}"\
+                               "vec3 vignetted(vec3 color, vec2 position, float vignette)"\
+                               "{"\
+                                   "float len = length(position);"\
+                                   "float vig = smoothstep(0.75, 0.75 - 0.45, len);"\
+                                   "return mix(color, color * vig, vignette);"\
+                               "}"\
+                               "vec3 gradeWith(vec3 color, vec4 p0, vec4 p1, vec4 p2, vec2 position)"\
+                               "{"\
+                                   "return vignetted(grade(color, p0.x, p0.y, p0.z, p0.w, p1.x, p1.y, p1.z, p1.w, p2.x), position, p2.y);"\
+                               "}"
+
+// fragment-shader code: grades the scene, and while comparing shows the ungraded scene (COMPARE_SPLIT) or the grade of
+// compareParams (COMPARE_PRESETS, as 3 vec4s like in gradeWith) left of the split, or the difference between the graded
+// and the ungraded scene (COMPARE_DIFFERENCE); compareMode takes the values of BLUfxCompareModes_t
 #define FRAGMENT_SHADER "#version 120\n"\
-                        "const vec3 lumCoeff = vec3(0.2125, 0.7154, 0.0721);"\
+                        GRADE_SHADER_FUNCTIONS\
                         "uniform float brightness;"\
                         "uniform float contrast;"\
                         "uniform float saturation;"\
@@ -484,79 +807,715 @@ BLUfxPreset BLUfxPresets [PRESET_MAX] =
                         "uniform vec2 resolution;"\
                         "uniform float vignette;"\
                         "uniform sampler2D scene;"\
+                        "uniform int compareMode;"\
+                        "uniform float split;"\
+                        "uniform vec4 compareParams[3];"\
                         "void main()"\
                         "{"\
-                            "vec3 color = texture2D(scene, gl_TexCoord[0].st).rgb;"\
-                            "color *= contrast;"\
-                            "color += vec3(brightness, brightness, brightness);"\
-                            "vec3 intensity = vec3(dot(color, lumCoeff));"\
-                            "color = mix(intensity, color, saturation);"\
-                            "vec3 newColor = (color.rgb - 0.5) * 2.0;"\
-                            "newColor.r = 2.0 / 3.0 * (1.0 - (newColor.r * newColor.r));"\
-                            "newColor.g = 2.0 / 3.0 * (1.0 - (newColor.g * newColor.g));"\
-                            "newColor.b = 2.0 / 3.0 * (1.0 - (newColor.b * newColor.b));"\
-                            "newColor.r = clamp(color.r + redScale * newColor.r + redOffset, 0.0, 1.0);"\
-                            "newColor.g = clamp(color.g + greenScale * newColor.g + greenOffset, 0.0, 1.0);"\
-                            "newColor.b = clamp(color.b + blueScale * newColor.b + blueOffset, 0.0, 1.0);"\
-                            "color = newColor;"\
+                            "vec3 original = texture2D(scene, gl_TexCoord[0].st).rgb;"\
                             "vec2 position = (gl_FragCoord.xy / resolution.xy) - vec2(0.5);"\
-                            "float len = length(position);"\
-                            "float vig = smoothstep(0.75, 0.75 - 0.45, len);"\
-                            "color = mix(color, color * vig, vignette);"\
+                            "vec3 color = vignetted(grade(original, brightness, contrast, saturation, redScale, greenScale, blueScale, redOffset, greenOffset, blueOffset), position, vignette);"\
+                            "bool left = gl_FragCoord.x < split;"\
+                            "if (compareMode == 1 && left)"\
+                                "color = original;"\
+                            "else if (compareMode == 2 && left)"\
+                                "color = gradeWith(original, compareParams[0], compareParams[1], compareParams[2], position);"\
+                            "else if (compareMode == 3)"\
+                                "color = clamp(abs(color - original) * " SHADER_NUMBER(COMPARE_DIFFERENCE_GAIN) ", 0.0, 1.0);"\
+                            "if ((compareMode == 1 || compareMode == 2) && abs(gl_FragCoord.x - split) < 1.0)"\
+                                "color = vec3(1.0);"\
                             "gl_FragColor = vec4(color, 1.0);"\
                         "}"
 
+// roles in the multi-instance synchronisation (see SYNC_HEARTBEAT_INTERVAL)
+enum BLUfxSyncModes_t
+{
+    SYNC_OFF = 0,
+    SYNC_MASTER,
+    SYNC_FOLLOWER
+};
+
+// low-latency mode: a fence is inserted after the post-processing pass each frame, and the CPU waits for the fence of
+// lowLatencyFrames frames ago before it goes on, so that it can't queue up more frames for the GPU than that (the sync
+// functions are looked up at runtime, since they are not part of every platform's GL headers)
+#define LOW_LATENCY_MAX_FRAMES 2
+#define LOW_LATENCY_TIMEOUT 100000000ull    /* ns, never wait longer than this for a fence */
+#define LOW_LATENCY_WAIT_SMOOTHING 0.05f    /* weight of the newest frame in the smoothed wait time */
+
+#ifndef APIENTRY
+#define APIENTRY            /* not defined by the macOS GL headers */
+#endif
+typedef struct __BLUfxGLsync *BLUfxGLsync;
+typedef BLUfxGLsync (APIENTRY *BLUfxFenceSyncProc)(GLenum condition, GLbitfield flags);
+typedef GLenum (APIENTRY *BLUfxClientWaitSyncProc)(BLUfxGLsync sync, GLbitfield flags, uint64_t timeout);
+typedef void (APIENTRY *BLUfxDeleteSyncProc)(BLUfxGLsync sync);
+
+#define BLUFX_GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define BLUFX_GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#define BLUFX_GL_ALREADY_SIGNALED 0x911A
+#define BLUFX_GL_CONDITION_SATISFIED 0x911C
+
+// input latency: the first frame drawn after a mouse event in the fake window gets a GPU timestamp query after the
+// post-processing pass (or, without timer queries, a fence that is polled every frame, which is only accurate to a
+// frame), the time from the event to the completion of that frame goes into a histogram like the frame times
+#define LATENCY_MAX_PROBES 4
+#define LATENCY_CALIBRATION_INTERVAL 1.0    /* seconds between two readings of the GPU clock */
+
+typedef long long BLUfxGLint64;
+typedef unsigned long long BLUfxGLuint64;
+typedef void (APIENTRY *BLUfxGenQueriesProc)(GLsizei n, GLuint *ids);
+typedef void (APIENTRY *BLUfxDeleteQueriesProc)(GLsizei n, const GLuint *ids);
+typedef void (APIENTRY *BLUfxQueryCounterProc)(GLuint id, GLenum target);
+typedef void (APIENTRY *BLUfxGetQueryObjectivProc)(GLuint id, GLenum pname, GLint *params);
+typedef void (APIENTRY *BLUfxGetQueryObjectui64vProc)(GLuint id, GLenum pname, BLUfxGLuint64 *params);
+typedef void (APIENTRY *BLUfxGetInteger64vProc)(GLenum pname, BLUfxGLint64 *data);
+
+#define BLUFX_GL_TIMESTAMP 0x8E28
+#define BLUFX_GL_QUERY_RESULT 0x8866
+#define BLUFX_GL_QUERY_RESULT_AVAILABLE 0x8867
+
+// a frame whose completion is awaited to measure the latency of the input it includes
+struct BLUfxLatencyProbe_t
+{
+    double inputTime;           // monotonic time of the first input event included in the frame
+    GLuint query;               // timestamp query after the pass (0 = fence is used)
+    BLUfxGLsync fence;
+};
+typedef BLUfxLatencyProbe_t BLUfxLatencyProbe;
+
+// preset browser: while the thumbnails are shown in the settings window, the captured scene is downsampled once into
+// a small texture, from which every preset of the catalog page is graded into its tile of the thumbnail atlas with a
+// single instanced draw that reads the parameters of each tile from a uniform buffer (without instancing and uniform
+// buffers, e.g. in the legacy macOS context, with one draw per tile and the parameters as uniforms); this is repeated
+// every THUMBNAIL_INTERVAL seconds at most, so that the thumbnails follow the scene
+#define THUMBNAIL_COLUMNS 3
+#define THUMBNAIL_ROWS (PRESET_PAGE_SIZE / THUMBNAIL_COLUMNS)
+#define THUMBNAIL_WIDTH 126                 /* texels (and boxels in the settings window) */
+#define THUMBNAIL_HEIGHT 40
+#define THUMBNAIL_TILE_HEIGHT (THUMBNAIL_HEIGHT + UI_TEXT_HEIGHT + 6)   /* boxels, with the name below the image */
+#define THUMBNAIL_INTERVAL 0.25f
+#define THUMBNAIL_PARAM_VECTORS (PRESET_PAGE_SIZE * 3)  /* vec4s in the uniform buffer, 3 per tile */
+
+enum BLUfxThumbnailModes_t
+{
+    THUMBNAILS_UNAVAILABLE = -1,    // no framebuffer objects or the shaders failed
+    THUMBNAILS_NOT_INITIALIZED = 0,
+    THUMBNAILS_PER_TILE,
+    THUMBNAILS_INSTANCED
+};
+
+#define THUMBNAIL_SHADER_HEADER "#version 120\n"
+#define THUMBNAIL_INSTANCED_SHADER_HEADER "#version 120\n"\
+                                          "#extension GL_ARB_draw_instanced : require\n"\
+                                          "#extension GL_ARB_uniform_buffer_object : require\n"\
+                                          "#define INSTANCED\n"
+
+// vertex-shader code of the thumbnails: places a unit quad into the tile of the instance (or of the tile uniform)
+#define THUMBNAIL_VERTEX_SHADER "uniform vec2 tiles;"\
+                                "uniform float tile;"\
+                                "varying vec2 tileCoord;"\
+                                "varying float tileIndex;"\
+                                "void main()"\
+                                "{"\
+                                    "\n#ifdef INSTANCED\n"\
+                                    "tileIndex = float(gl_InstanceIDARB);"\
+                                    "\n#else\n"\
+                                    "tileIndex = tile;"\
+                                    "\n#endif\n"\
+                                    "vec2 cell = vec2(floor(mod(tileIndex + 0.5, tiles.x)), tiles.y - 1.0 - floor((tileIndex + 0.5) / tiles.x));"\
+                                    "tileCoord = gl_Vertex.xy;"\
+                                    "gl_Position = vec4((cell + tileCoord) / tiles * 2.0 - 1.0, 0.0, 1.0);"\
+                                "}"
+
+// fragment-shader code of the thumbnails: the grade of the post-processing pass with the parameters of the tile
+#define THUMBNAIL_FRAGMENT_SHADER "\n#ifdef INSTANCED\n"\
+                                  "layout(std140) uniform PresetParams { vec4 presetParams[" SHADER_NUMBER(THUMBNAIL_PARAM_VECTORS) "]; };"\
+                                  "\n#else\n"\
+                                  "uniform vec4 presetParams[3];"\
+                                  "\n#endif\n"\
+                                  GRADE_SHADER_FUNCTIONS\
+                                  "uniform sampler2D scene;"\
+                                  "uniform float band;"\
+                                  "varying vec2 tileCoord;"\
+                                  "varying float tileIndex;"\
+                                  "void main()"\
+                                  "{"\
+                                      "\n#ifdef INSTANCED\n"\
+                                      "int base = int(tileIndex + 0.5) * 3;"\
+                                      "\n#else\n"\
+                                      "int base = 0;"\
+                                      "\n#endif\n"\
+                                      "vec2 position = vec2(tileCoord.x - 0.5, (tileCoord.y - 0.5) * band);"\
+                                      "vec3 color = gradeWith(texture2D(scene, tileCoord).rgb, presetParams[base], presetParams[base + 1], presetParams[base + 2], position);"\
+                                      "gl_FragColor = vec4(color, 1.0);"\
+                                  "}"
+
+// fragment-shader code of the downsampling of the captured scene: a box filter of 4 x 4 bilinear samples over the
+// footprint of a texel of the small texture
+#define DOWNSAMPLE_SHADER "#version 120\n"\
+                          "uniform sampler2D scene;"\
+                          "uniform vec2 footprint;"\
+                          "void main()"\
+                          "{"\
+                              "vec3 sum = vec3(0.0);"\
+                              "for (int i = 0; i < 4; i++)"\
+                                  "for (int j = 0; j < 4; j++)"\
+                                      "sum += texture2D(scene, gl_TexCoord[0].st + (vec2(i, j) - 1.5) * 0.25 * footprint).rgb;"\
+                              "gl_FragColor = vec4(sum / 16.0, 1.0);"\
+                          "}"
+
+typedef void (APIENTRY *BLUfxGenFramebuffersProc)(GLsizei n, GLuint *framebuffers);
+typedef void (APIENTRY *BLUfxDeleteFramebuffersProc)(GLsizei n, const GLuint *framebuffers);
+typedef void (APIENTRY *BLUfxBindFramebufferProc)(GLenum target, GLuint framebuffer);
+typedef void (APIENTRY *BLUfxFramebufferTexture2DProc)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+typedef GLenum (APIENTRY *BLUfxCheckFramebufferStatusProc)(GLenum target);
+typedef void (APIENTRY *BLUfxDrawArraysInstancedProc)(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+typedef GLuint (APIENTRY *BLUfxGetUniformBlockIndexProc)(GLuint program, const GLchar *name);
+typedef void (APIENTRY *BLUfxUniformBlockBindingProc)(GLuint program, GLuint index, GLuint binding);
+typedef void (APIENTRY *BLUfxBindBufferBaseProc)(GLenum target, GLuint index, GLuint buffer);
+
+#define BLUFX_GL_FRAMEBUFFER 0x8D40
+#define BLUFX_GL_FRAMEBUFFER_BINDING 0x8CA6
+#define BLUFX_GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#define BLUFX_GL_COLOR_ATTACHMENT0 0x8CE0
+#define BLUFX_GL_UNIFORM_BUFFER 0x8A11
+#define BLUFX_GL_INVALID_INDEX 0xFFFFFFFFu
+
+// performance HUD: an overlay in the top right corner of the screen, drawn after the post-processing pass, with the
+// frame time, the sleep of the limiter, the GPU time of the post-processing pass (from timestamp queries that are read
+// a few frames later, without waiting), the VRAM use (where the driver reports it) and a graph of the last frame
+// times; it is described with the immediate-mode UI of the settings window and drawn from one vertex buffer, which is
+// refilled once per frame, with one draw call
+#define HUD_WIDTH 300                       /* boxels, like the rest of the HUD layout */
+#define HUD_MARGIN 20
+#define HUD_LINES 4
+#define HUD_GRAPH_FRAMES 140                /* two boxels per frame */
+#define HUD_GRAPH_HEIGHT 60
+#define HUD_GRAPH_MAX_FRAME_TIME 50.0f      /* ms at the top of the graph */
+#define HUD_TEXT_INTERVAL 0.25              /* seconds between two updates of the numbers (averages over that time) */
+#define HUD_GPU_QUERIES 4                   /* frames of post-processing timestamps in flight */
+
+#define BLUFX_GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX 0x9048
+#define BLUFX_GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049
+#define BLUFX_GL_TEXTURE_FREE_MEMORY_ATI 0x87FC
+
+// where the driver reports the VRAM use
+enum BLUfxVramInfo_t
+{
+    VRAM_INFO_NONE = -1,
+    VRAM_INFO_UNKNOWN = 0,      // not checked yet
+    VRAM_INFO_NVX,              // GL_NVX_gpu_memory_info: total and available
+    VRAM_INFO_ATI               // GL_ATI_meminfo: free in the texture pool
+};
+
+// state of the performance HUD
+struct BLUfxHud_t
+{
+    BLUfxUi ui;
+    GLuint buffer;                              // vertex buffer of ui.vertices
+    GLuint queries[HUD_GPU_QUERIES][2];         // timestamps before and after the post-processing pass
+    int queryFirst, queryCount, queryStarted;
+    int vramInfo;                               // BLUfxVramInfo_t
+    double textTime;                            // monotonic time of the last update of the numbers
+    double frameTimeSum, sleepSum, gpuTimeSum;  // ms, since then
+    int frames, gpuFrames;
+    char lines[HUD_LINES][64];
+};
+typedef BLUfxHud_t BLUfxHud;
+
+// clamps b to the range [a, c]
+#define minMax(a,b,c) (std::min((std::max((a), (b))),(c)))
+
 // macros for version number relation functionality (i.e., "legacy" or not)
 static int xplmVersionNum = 0;							// filled in at startup
 #define IS_XP12         (xplmVersionNum >= 120000)
 #define LEGACY_FEATURES (!IS_XP12)
 
 // global settings variables
+static int remoteControlEnabled = DEFAULT_REMOTE_CONTROL_ENABLED, remoteControlPort = DEFAULT_REMOTE_CONTROL_PORT;
+static int syncMode = DEFAULT_SYNC_MODE, syncPort = DEFAULT_SYNC_PORT;
+static std::string syncGroup = DEFAULT_SYNC_GROUP;
+static std::string powerSysfsRoot = DEFAULT_POWER_SYSFS_ROOT;
 static int postProcesssingEnabled = DEFAULT_POST_PROCESSING_ENABLED, fpsLimiterEnabled = DEFAULT_FPS_LIMITER_ENABLED, controlCinemaVeriteEnabled = DEFAULT_CONTROL_CINEMA_VERITE_ENABLED;
-static float maxFps = DEFAULT_MAX_FRAME_RATE, disableCinemaVeriteTime = DEFAULT_DISABLE_CINEMA_VERITE_TIME;
+static int adaptiveFpsEnabled = DEFAULT_ADAPTIVE_FPS_ENABLED;
+static float maxFps = DEFAULT_MAX_FRAME_RATE, refreshRate = DEFAULT_REFRESH_RATE, pausedFps = DEFAULT_PAUSED_FPS, replayFps = DEFAULT_REPLAY_FPS, batteryFps = DEFAULT_BATTERY_FPS, hotFps = DEFAULT_HOT_FPS, hotTemperature = DEFAULT_HOT_TEMPERATURE, disableCinemaVeriteTime = DEFAULT_DISABLE_CINEMA_VERITE_TIME, transitionTime = DEFAULT_TRANSITION_TIME;
 static float brightness = BLUfxPresets[PRESET_DEFAULT].brightness, contrast = BLUfxPresets[PRESET_DEFAULT].contrast, saturation = BLUfxPresets[PRESET_DEFAULT].saturation, redScale = BLUfxPresets[PRESET_DEFAULT].redScale, greenScale = BLUfxPresets[PRESET_DEFAULT].greenScale, blueScale = BLUfxPresets[PRESET_DEFAULT].blueScale, redOffset = BLUfxPresets[PRESET_DEFAULT].redOffset, greenOffset = BLUfxPresets[PRESET_DEFAULT].greenOffset, blueOffset = BLUfxPresets[PRESET_DEFAULT].blueOffset, vignette = BLUfxPresets[PRESET_DEFAULT].vignette, raleighScale = DEFAULT_RALEIGH_SCALE;
 
-// static function to determine whether a given BLUfxPreset matches the current settings globals:
-bool isActivePreset (BLUfxPreset_t *preset)
-{
-	return (!preset ? false :
-					  preset->brightness == brightness &&
-					  preset->saturation == saturation &&
-					  preset->blueOffset == blueOffset &&
-					  preset->blueScale == blueScale &&
-					  preset->contrast == contrast &&
-//					  preset->disableCinemaVeriteTime == disableCinemaVeriteTime &&
-					  preset->greenOffset == greenOffset &&
-					  preset->greenScale == greenScale &&
-//					  preset->maxFps == maxFps &&
-					  (IS_XP12 || preset->raleighScale == raleighScale) &&
-					  preset->redOffset == redOffset &&
-					  preset->redScale == redScale &&
-					  preset->vignette == vignette);
-};
+// returns a hash of grading parameters (and the raleigh scale before XP12) quantized to PRESET_FINGERPRINT_STEP, so
+// that a preset matches the current settings if their fingerprints are equal
+static uint64_t Fingerprint(const float *params, float raleigh)
+{
+    uint64_t hash = 14695981039346656037ull;   // FNV-1a
+    for (int i = 0; i <= PARAM_MAX; i++)
+    {
+        float value = i < PARAM_MAX ? params[i] : (IS_XP12 ? 0.0f : raleigh);
+        uint32_t quantized = (uint32_t) (int32_t) lrintf(value / PRESET_FINGERPRINT_STEP);
+        for (int j = 0; j < 4; j++)
+        {
+            hash ^= (quantized >> (j * 8)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    }
+
+    return hash;
+}
+
+// returns the fingerprint of a preset (maxFps and disableCinemaVeriteTime are settings, so they don't count)
+static inline uint64_t PresetFingerprint(const BLUfxPreset *preset)
+{
+    return Fingerprint(PresetParams(preset), preset->raleighScale);
+}
+
+// fingerprints of BLUfxPresets, so that the settings windows don't hash every preset on every refresh
+static uint64_t presetFingerprints[PRESET_MAX];
+
+// updates the cached fingerprint of a built-in preset, whenever its values change
+static inline void UpdatePresetFingerprint(int preset)
+{
+    presetFingerprints[preset] = PresetFingerprint(&BLUfxPresets[preset]);
+}
 
 // global internal variables
 static int lastResolutionX = 0, lastResolutionY = 0, bringFakeWindowToFront = 0, overrideControlCinemaVerite = 0;
+static int cinemaVeriteWritten = -1, interiorCinemaVeriteWritten = -1, exteriorCinemaVeriteWritten = -1;  // -1 = unknown
 static GLuint textureId = 0, program = 0, fragmentShader = 0;
-static float startTimeFlight = 0.0f, endTimeFlight = 0.0f, startTimeDraw = 0.0f, endTimeDraw = 0.0f, lastMouseUsageTime = 0.0f;
+static float transitionFrom[PARAM_MAX], transitionTo[PARAM_MAX], transitionElapsed = 0.0f;
+static int transitionActive = 0;
+static float pendingParams[PARAM_MAX];      // dataref writes, applied once per frame by ParameterFlightLoopCallback
+static unsigned int pendingParamsMask = 0;
+static int pendingParamsBlend = 0;
+static int pendingSliderUpdate = 0, pendingRaleighScale = 0;    // slider events since the last frame
+static XPLMFlightLoopID parameterFlightLoop = NULL;
+
+static BLUfxRemoteMailbox remoteMailbox;   // posted to by the receiving threads, taken by RemoteMailboxTask
+static BLUfxParamReceiver remoteControlReceiver, syncReceiver;
+static std::atomic<bool> remoteControlRunning(false);
+static std::thread remoteControlThread;
+static BLUfxSocket remoteControlSocket = INVALID_BLUFX_SOCKET;
+static std::atomic<bool> syncRunning(false);
+static std::thread syncThread;
+static BLUfxSocket syncSocket = INVALID_BLUFX_SOCKET;
+static double syncMasterLastRun = 0.0;          // GetMonotonicTime of the last run of the sync master task
+static BLUfxSyncMaster syncMaster;
+static float lastMouseUsageTime = 0.0f;
+static int mouseInUse = 0, viewType = 0;                    // state of the cinema verite control
+static XPLMFlightLoopID cinemaVeriteTimerFlightLoop = NULL;
 static XPLMWindowID fakeWindow = NULL;
+static int layoutStale = 1, settingsWidgetMoved = 0;   // see SCREEN_BOUNDS_POLL_INTERVAL
+static int layoutScreenWidth = 0, layoutScreenHeight = 0, layoutScreenBounds[4] = {0};
+static BLUfxPacer limiterPacer;
+static XPLMFlightLoopID schedulerFlightLoop = NULL;
+static BLUfxTask tasks[TASK_MAX];
+static BLUfxFrameState currentFrameState;
+static const BLUfxFrameState &frameState = currentFrameState;   // read-only view, written only by FrameStateTask
+static int xplmCallCount = 0;                   // XPLM calls made during the current frame
+static BLUfxLog logQueue;                       // written by any thread, drained into Log.txt by FlushLogTask
+static int logLevel = DEFAULT_LOG_LEVEL;
+static BLUfxFrameStats frameStats;
+static BLUfxFrameStats workStats;           // unconstrained frame times, measured by the limiter
+static BLUfxFrameStats latencyStats;        // input latencies (time from a mouse event to the completion of its frame)
+static double limiterFrameStart = 0.0, adaptiveFpsEvaluationTime = 0.0;
+static float adaptiveFps = 0.0f;
+static int adaptiveFpsRaiseIntervals = 0;
+static int limiterActive = 0, simContext = SIM_CONTEXT_FLYING;
+static int limiterSessionEnabled = 0;          // whether the FPS-Limiter itself was on while the limiter task ran
+static std::atomic<int> hostPowerState(0);      // POWER_* bits, written by the power monitor thread
+static int powerState = 0;                      // hostPowerState as last seen by the sim thread
+static std::atomic<bool> powerMonitorRunning(false);
+static std::thread powerMonitorThread;
+static int lowLatencyFrames = DEFAULT_LOW_LATENCY_FRAMES;
+static int modernSettingsWindow = DEFAULT_MODERN_SETTINGS_WINDOW;
+static XPLMWindowID settingsWindow = NULL;      // immediate-mode settings window, created when first shown
+static BLUfxUi settingsUi;
+static bool settingsWindowHasKeyboard = false;  // whether the search field of the settings window has the keyboard
+static char presetSearchText[64] = "";          // search field of the immediate-mode settings window
+static int uiFontTexture = 0;
+static BLUfxFenceSyncProc glFenceSyncProc = NULL;
+static BLUfxClientWaitSyncProc glClientWaitSyncProc = NULL;
+static BLUfxDeleteSyncProc glDeleteSyncProc = NULL;
+static int syncFunctionsLoaded = 0;             // 0 = not tried yet, 1 = available, -1 = unavailable
+static BLUfxGLsync frameFences[LOW_LATENCY_MAX_FRAMES + 1] = {NULL};
+static int frameFenceFirst = 0, frameFenceCount = 0;
+static long gpuWaitFrames = 0;
+static double gpuWaitSum = 0.0, gpuWaitMax = 0.0;
+static float gpuWaitSmoothed = 0.0f;           // ms
+static double pendingInputTime = 0.0;           // first input event not yet included in a drawn frame (0 = none)
+static BLUfxGenQueriesProc glGenQueriesProc = NULL;
+static BLUfxDeleteQueriesProc glDeleteQueriesProc = NULL;
+static BLUfxQueryCounterProc glQueryCounterProc = NULL;
+static BLUfxGetQueryObjectivProc glGetQueryObjectivProc = NULL;
+static BLUfxGetQueryObjectui64vProc glGetQueryObjectui64vProc = NULL;
+static BLUfxGetInteger64vProc glGetInteger64vProc = NULL;
+static int timerQueryFunctionsLoaded = 0;       // 0 = not tried yet, 1 = available, -1 = unavailable
+static GLuint latencyQueries[LATENCY_MAX_PROBES] = {0};
+static BLUfxLatencyProbe latencyProbes[LATENCY_MAX_PROBES];
+static int latencyProbeFirst = 0, latencyProbeCount = 0;
+static double gpuClockOffset = 0.0, gpuClockCalibrationTime = 0.0;
+static int presetThumbnailsEnabled = DEFAULT_PRESET_THUMBNAILS;
+static int compareMode = DEFAULT_COMPARE_MODE, compareDragging = 0, comparePinned = 0;
+static float compareSplit = DEFAULT_COMPARE_SPLIT;
+static float comparePinnedParams[PARAM_MAX];    // the "B" side of COMPARE_PRESETS once pinned (else the user preset)
+static int thumbnailMode = THUMBNAILS_NOT_INITIALIZED;
+static BLUfxGenFramebuffersProc glGenFramebuffersProc = NULL;
+static BLUfxDeleteFramebuffersProc glDeleteFramebuffersProc = NULL;
+static BLUfxBindFramebufferProc glBindFramebufferProc = NULL;
+static BLUfxFramebufferTexture2DProc glFramebufferTexture2DProc = NULL;
+static BLUfxCheckFramebufferStatusProc glCheckFramebufferStatusProc = NULL;
+static BLUfxDrawArraysInstancedProc glDrawArraysInstancedProc = NULL;
+static BLUfxGetUniformBlockIndexProc glGetUniformBlockIndexProc = NULL;
+static BLUfxUniformBlockBindingProc glUniformBlockBindingProc = NULL;
+static BLUfxBindBufferBaseProc glBindBufferBaseProc = NULL;
+static GLuint thumbnailFramebuffer = 0, thumbnailParamBuffer = 0, thumbnailProgram = 0, downsampleProgram = 0;
+static int thumbnailSceneTexture = 0, thumbnailAtlasTexture = 0;
+static int thumbnailEntries[PRESET_PAGE_SIZE];  // catalog entries in the tiles of the atlas (-1 = none)
+static float thumbnailTime = 0.0f;              // elapsed time of the last regeneration
+static int thumbnailsStale = 1;                 // regenerate with the next frame, e.g. after a page change
+static int hudEnabled = 0;
+static BLUfxHud hud;
+static float limiterSleepTime = 0.0f;           // ms, of the last frame
+
+// global preset catalog variables
+static std::vector<BLUfxCatalogEntry> presetCatalog;
+static std::vector<int> presetCatalogView;      // indices of the catalog entries matching the search text
+static int presetCatalogPage = 0;
 
 // global dataref variables
+static XPLMDataRef paramDataRefs[PARAM_MAX] = {NULL}, paramsDataRef = NULL, statsDataRefs[STAT_MAX] = {NULL}, taskTimesDataRef = NULL, latencyDataRefs[STAT_FRAME_TIME_P99 + 1] = {NULL}, fpsCapDataRef = NULL, gpuWaitDataRef = NULL;
+static XPLMDataRef pausedDataRef = NULL, replayDataRef = NULL;
+static XPLMDataRef interiorCinemaVeriteDataRef = NULL, exteriorCinemaVeriteDataRef = NULL;
 static XPLMDataRef cinemaVeriteDataRef = NULL, viewTypeDataRef = NULL, raleighScaleDataRef = NULL, overrideControlCinemaVeriteDataRef = NULL, ignitionKeyDataRef = NULL;
-static XPLMDataRef xplmVersionDataRef = XPLMFindDataRef("sim/version/xplane_internal_version");
+static XPLMDataRef xplmVersionDataRef = NULL, xplmCallsDataRef = NULL;
+
+// all datarefs of X-Plane used by BLU-fx, resolved by ResolveDataRefs
+static const BLUfxDataRefBinding dataRefBindings[] =
+{
+    {"sim/version/xplane_internal_version", &xplmVersionDataRef},
+    {"sim/graphics/view/cinema_verite", &cinemaVeriteDataRef},
+    {CINEMA_VERITE_INTERIOR_DATAREF, &interiorCinemaVeriteDataRef},
+    {CINEMA_VERITE_EXTERIOR_DATAREF, &exteriorCinemaVeriteDataRef},
+    {"sim/graphics/view/view_type", &viewTypeDataRef},
+    {"sim/time/paused", &pausedDataRef},
+    {"sim/time/is_in_replay", &replayDataRef},
+    {"sim/private/controls/atmo/atmo_scale_raleigh", &raleighScaleDataRef},
+//    {"sim/cockpit2/engine/actuators/ignition_key", &ignitionKeyDataRef},	// no longer used
+};
 
 // global widget variables
-static XPWidgetID settingsWidget = NULL, postProcessingCheckbox = NULL, fpsLimiterCheckbox = NULL, controlCinemaVeriteCheckbox = NULL, brightnessCaption = NULL, contrastCaption = NULL, saturationCaption = NULL, redScaleCaption = NULL, greenScaleCaption = NULL, blueScaleCaption = NULL, redOffsetCaption = NULL, greenOffsetCaption = NULL, blueOffsetCaption = NULL, vignetteCaption = NULL, raleighScaleCaption = NULL, maxFpsCaption = NULL, disableCinemaVeriteTimeCaption, brightnessSlider = NULL, contrastSlider = NULL, saturationSlider = NULL, redScaleSlider = NULL, greenScaleSlider = NULL, blueScaleSlider = NULL, redOffsetSlider = NULL, greenOffsetSlider = NULL, blueOffsetSlider = NULL, vignetteSlider = NULL, raleighScaleSlider = NULL, maxFpsSlider = NULL, disableCinemaVeriteTimeSlider = NULL, presetButtons[PRESET_MAX] = {NULL}, resetRaleighScaleButton = NULL, saveButton = NULL, loadButton = NULL;
+static XPWidgetID settingsWidget = NULL, postProcessingCheckbox = NULL, fpsLimiterCheckbox = NULL, adaptiveFpsCheckbox = NULL, controlCinemaVeriteCheckbox = NULL, brightnessCaption = NULL, contrastCaption = NULL, saturationCaption = NULL, redScaleCaption = NULL, greenScaleCaption = NULL, blueScaleCaption = NULL, redOffsetCaption = NULL, greenOffsetCaption = NULL, blueOffsetCaption = NULL, vignetteCaption = NULL, raleighScaleCaption = NULL, maxFpsCaption = NULL, disableCinemaVeriteTimeCaption, transitionTimeCaption = NULL, brightnessSlider = NULL, contrastSlider = NULL, saturationSlider = NULL, redScaleSlider = NULL, greenScaleSlider = NULL, blueScaleSlider = NULL, redOffsetSlider = NULL, greenOffsetSlider = NULL, blueOffsetSlider = NULL, vignetteSlider = NULL, raleighScaleSlider = NULL, maxFpsSlider = NULL, disableCinemaVeriteTimeSlider = NULL, transitionTimeSlider = NULL, presetButtons[PRESET_MAX] = {NULL}, presetPageButtons[PRESET_PAGE_SIZE] = {NULL}, presetSearchField = NULL, presetPageCaption = NULL, presetPreviousPageButton = NULL, presetNextPageButton = NULL, resetRaleighScaleButton = NULL, saveButton = NULL, loadButton = NULL;
+
+// table of the grading parameters, indexed by BLUfxParams_t
+struct BLUfxParamInfo_t
+{
+    const char *name;           // same as the key in the config and preset files, and the name of its dataref
+    float *value;
+    XPWidgetID *slider;
+    float min, max;             // same range as the slider
+};
+static const BLUfxParamInfo_t BLUfxParams [PARAM_MAX] =
+{
+    {"brightness", &brightness, &brightnessSlider, -0.5f, 0.5f},
+    {"contrast", &contrast, &contrastSlider, 0.05f, 2.0f},
+    {"saturation", &saturation, &saturationSlider, 0.0f, 2.5f},
+    {"redScale", &redScale, &redScaleSlider, -0.75f, 0.75f},
+    {"greenScale", &greenScale, &greenScaleSlider, -0.75f, 0.75f},
+    {"blueScale", &blueScale, &blueScaleSlider, -0.75f, 0.75f},
+    {"redOffset", &redOffset, &redOffsetSlider, -0.5f, 0.5f},
+    {"greenOffset", &greenOffset, &greenOffsetSlider, -0.5f, 0.5f},
+    {"blueOffset", &blueOffset, &blueOffsetSlider, -0.5f, 0.5f},
+    {"vignette", &vignette, &vignetteSlider, 0.0f, 1.0f}
+};
+
+// a caption and slider pair of the settings window, refreshed by UpdateSettingsWidgets only when its value changed
+struct BLUfxSettingRow_t
+{
+    const char *format;         // of the caption
+    float *value;
+    XPWidgetID *caption, *slider;
+    float sliderOffset, sliderScale;    // slider position = (value + sliderOffset) * sliderScale, rounded
+    int sliderMin, sliderMax;   // slider positions, same as the widget's
+    int legacyOnly;             // caption only updated before XP12
+};
+static const BLUfxSettingRow_t BLUfxSettingRows [] =
+{
+    {"Brightness: %.2f", &brightness, &brightnessCaption, &brightnessSlider, 0.5f, 1000.0f, 1, 1000, 0},
+    {"Contrast: %.2f", &contrast, &contrastCaption, &contrastSlider, 0.0f, 100.0f, 5, 200, 0},
+    {"Saturation: %.2f", &saturation, &saturationCaption, &saturationSlider, 0.0f, 100.0f, 0, 250, 0},
+    {"Red Scale: %.2f", &redScale, &redScaleCaption, &redScaleSlider, 0.0f, 100.0f, -75, 75, 0},
+    {"Green Scale: %.2f", &greenScale, &greenScaleCaption, &greenScaleSlider, 0.0f, 100.0f, -75, 75, 0},
+    {"Blue Scale: %.2f", &blueScale, &blueScaleCaption, &blueScaleSlider, 0.0f, 100.0f, -75, 75, 0},
+    {"Red Offset: %.2f", &redOffset, &redOffsetCaption, &redOffsetSlider, 0.0f, 100.0f, -50, 50, 0},
+    {"Green Offset: %.2f", &greenOffset, &greenOffsetCaption, &greenOffsetSlider, 0.0f, 100.0f, -50, 50, 0},
+    {"Blue Offset: %.2f", &blueOffset, &blueOffsetCaption, &blueOffsetSlider, 0.0f, 100.0f, -50, 50, 0},
+    {"Vignette: %.2f", &vignette, &vignetteCaption, &vignetteSlider, 0.0f, 100.0f, 0, 100, 0},
+    {"Raleigh Scale: %.2f", &raleighScale, &raleighScaleCaption, &raleighScaleSlider, 0.0f, 1.0f, 1, 100, 1},
+    {"Max FPS: %.0f", &maxFps, &maxFpsCaption, &maxFpsSlider, 0.0f, 1.0f, 20, 200, 0},
+    {"On input disable for: %.0f sec", &disableCinemaVeriteTime, &disableCinemaVeriteTimeCaption, &disableCinemaVeriteTimeSlider, 0.0f, 1.0f, 1, 30, 0},
+    {"Transition: %.1f sec", &transitionTime, &transitionTimeCaption, &transitionTimeSlider, 0.0f, 10.0f, 0, 50, 0},
+};
+#define SETTING_ROWS ((int) (sizeof(BLUfxSettingRows) / sizeof(BLUfxSettingRows[0])))
+#define SETTING_ROW_RALEIGH_SCALE PARAM_MAX     /* rows after the grading parameters */
+#define SETTING_ROW_MAX_FPS (PARAM_MAX + 1)
+#define SETTING_ROW_DISABLE_CINEMA_VERITE_TIME (PARAM_MAX + 2)
+#define SETTING_ROW_TRANSITION_TIME (PARAM_MAX + 3)
+
+// returns the slider position of a value of a settings row
+static inline int SliderPosition(const BLUfxSettingRow_t *row, float value)
+{
+    return (int) lrintf((value + row->sliderOffset) * row->sliderScale);
+}
+
+// returns a value limited to what the slider of a settings row can be set to
+static inline float ClampToSettingRow(const BLUfxSettingRow_t *row, float value)
+{
+    return minMax(row->sliderMin / row->sliderScale - row->sliderOffset, value, row->sliderMax / row->sliderScale - row->sliderOffset);
+}
+
+// a checkbox of the settings window and the setting it shows
+struct BLUfxSettingCheckbox_t
+{
+    XPWidgetID *checkbox;
+    int *value;
+};
+static const BLUfxSettingCheckbox_t BLUfxSettingCheckboxes [] =
+{
+    {&postProcessingCheckbox, &postProcesssingEnabled},
+    {&fpsLimiterCheckbox, &fpsLimiterEnabled},
+    {&adaptiveFpsCheckbox, &adaptiveFpsEnabled},
+    {&controlCinemaVeriteCheckbox, &controlCinemaVeriteEnabled},
+};
+#define SETTING_CHECKBOXES ((int) (sizeof(BLUfxSettingCheckboxes) / sizeof(BLUfxSettingCheckboxes[0])))
+
+// what the settings widgets currently show, so that UpdateSettingsWidgets only touches the widgets whose value changed
+// (values of NaN and states of -1 = unknown, see InvalidateSettingsWidgets)
+static float shownSettingValues[SETTING_ROWS];
+static int shownSliderPositions[SETTING_ROWS];
+static char shownCaptions[SETTING_ROWS][32];
+static int shownCheckboxes[SETTING_CHECKBOXES];
+static char shownAdaptiveFpsCaption[32];
+static int shownPresetActive[PRESET_MAX], shownPageActive[PRESET_PAGE_SIZE];
+static long widgetCallCount = 0, sliderEvents = 0, sliderEventWidgetCalls = 0;
+
+// counts a call to the widgets library made while refreshing the settings window (which is a call into X-Plane too)
+#define WIDGET_CALL(call) (widgetCallCount++, xplmCallCount++, (call))
+
+static void UpdateSettingsWidgets(void);
+static void ShowSettingsWindow(int visible);
+static void UpdateInputLatency(void);
+static inline bool PresetThumbnailsShown(void);
+static void RenderPresetThumbnails(int sceneWidth, int sceneHeight);
+static BLUfxPreset *LoadCatalogPreset(BLUfxCatalogEntry *entry);
+static void MarkHudGpuTime(int end);
+
+// returns the address of a GL function, or NULL if the driver doesn't have it
+static void *GetGLProcAddress(const char *name)
+{
+#if IBM
+    return (void *) wglGetProcAddress(name);
+#elif APL
+    return dlsym(RTLD_DEFAULT, name);
+#else
+    return (void *) glXGetProcAddressARB((const GLubyte *) name);
+#endif
+}
+
+// looks up the fence sync functions (GL 3.2 / ARB_sync, APPLE_sync in the legacy macOS context), returns false if
+// they are not available
+static bool LoadSyncFunctions(void)
+{
+    if (syncFunctionsLoaded == 0)
+    {
+#if APL
+        glFenceSyncProc = (BLUfxFenceSyncProc) GetGLProcAddress("glFenceSyncAPPLE");
+        glClientWaitSyncProc = (BLUfxClientWaitSyncProc) GetGLProcAddress("glClientWaitSyncAPPLE");
+        glDeleteSyncProc = (BLUfxDeleteSyncProc) GetGLProcAddress("glDeleteSyncAPPLE");
+#else
+        glFenceSyncProc = (BLUfxFenceSyncProc) GetGLProcAddress("glFenceSync");
+        glClientWaitSyncProc = (BLUfxClientWaitSyncProc) GetGLProcAddress("glClientWaitSync");
+        glDeleteSyncProc = (BLUfxDeleteSyncProc) GetGLProcAddress("glDeleteSync");
+#endif
+        syncFunctionsLoaded = glFenceSyncProc != NULL && glClientWaitSyncProc != NULL && glDeleteSyncProc != NULL ? 1 : -1;
+        if (syncFunctionsLoaded < 0)
+            LogWrite(&logQueue, LOG_WARNING, NAME_VERSION": Low-latency mode is not available, the OpenGL driver has no fence sync functions.\n");
+    }
+
+    return syncFunctionsLoaded > 0;
+}
+
+// inserts a fence after this frame's commands and waits until at most lowLatencyFrames frames are queued on the GPU
+static void LimitFramesInFlight(void)
+{
+    if (!LoadSyncFunctions())
+        return;
+
+    int frames = minMax(1, lowLatencyFrames, LOW_LATENCY_MAX_FRAMES);
+    frameFences[(frameFenceFirst + frameFenceCount++) % (LOW_LATENCY_MAX_FRAMES + 1)] = glFenceSyncProc(BLUFX_GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    while (frameFenceCount > frames)
+    {
+        BLUfxGLsync fence = frameFences[frameFenceFirst];
+        frameFences[frameFenceFirst] = NULL;
+        frameFenceFirst = (frameFenceFirst + 1) % (LOW_LATENCY_MAX_FRAMES + 1);
+        frameFenceCount--;
+
+        if (fence == NULL)
+            continue;
+
+        double start = GetMonotonicTime();
+        glClientWaitSyncProc(fence, BLUFX_GL_SYNC_FLUSH_COMMANDS_BIT, LOW_LATENCY_TIMEOUT);
+        double wait = GetMonotonicTime() - start;
+        glDeleteSyncProc(fence);
+
+        gpuWaitFrames++;
+        gpuWaitSum += wait;
+        gpuWaitMax = std::max(gpuWaitMax, wait);
+        gpuWaitSmoothed += LOW_LATENCY_WAIT_SMOOTHING * ((float) (wait * 1000.0) - gpuWaitSmoothed);
+    }
+}
+
+// deletes the outstanding fences (e.g. when post-processing is switched off) and writes the wait times to Log.txt
+static void ReleaseFrameFences(void)
+{
+    for (int i = 0; i < frameFenceCount; i++)
+    {
+        int index = (frameFenceFirst + i) % (LOW_LATENCY_MAX_FRAMES + 1);
+        if (frameFences[index] != NULL && glDeleteSyncProc != NULL)
+            glDeleteSyncProc(frameFences[index]);
+        frameFences[index] = NULL;
+    }
+    frameFenceFirst = frameFenceCount = 0;
+    gpuWaitSmoothed = 0.0f;
+
+    if (gpuWaitFrames == 0)
+        return;
+
+    LogFormat(&logQueue, LOG_INFO, NAME_VERSION": Low-latency mode: %ld frames, waited for the GPU %.2f ms per frame on average, %.2f ms at most.\n", gpuWaitFrames, gpuWaitSum / gpuWaitFrames * 1000.0, gpuWaitMax * 1000.0);
+    gpuWaitFrames = 0;
+    gpuWaitSum = gpuWaitMax = 0.0;
+}
+
+// sets up a task of the scheduler (inactive until SetTaskActive), everySeconds = 0 runs it every everyFrames frames
+static void InitTask(int task, const char *name, void (*run)(void), int everyFrames, float everySeconds)
+{
+    memset(&tasks[task], 0, sizeof(tasks[task]));
+    tasks[task].name = name;
+    tasks[task].run = run;
+    tasks[task].everyFrames = std::max(1, everyFrames);
+    tasks[task].everySeconds = everySeconds;
+}
+
+// adds a task to or removes it from the scheduler, an added task first runs in the next frame
+static void SetTaskActive(int task, int active)
+{
+    tasks[task].active = active;
+    tasks[task].framesLeft = 1;
+    tasks[task].nextTime = 0.0;
+}
+
+// lets an active task run in the next frame instead of waiting for its interval (e.g., because it has work now)
+static void WakeTask(int task)
+{
+    if (tasks[task].active)
+    {
+        tasks[task].framesLeft = 1;
+        tasks[task].nextTime = 0.0;
+    }
+}
+
+// flightloop-callback of the scheduler, which runs the active tasks that are due (see BLUfxTasks_t for the order)
+static float SchedulerFlightLoopCallback(float, float, int, void *)
+{
+    for (int i = 0; i < TASK_MAX; i++)
+    {
+        BLUfxTask *task = &tasks[i];
+        if (!task->active)
+            continue;
+
+        double start = GetMonotonicTime();
+        if (task->everySeconds > 0.0f)
+        {
+            if (start < task->nextTime)
+                continue;
+            task->nextTime = start + task->everySeconds;
+        }
+        else if (--task->framesLeft > 0)
+            continue;
+        else
+            task->framesLeft = task->everyFrames;
+
+        task->run();
+
+        double runTime = GetMonotonicTime() - start;
+        task->runs++;
+        task->runTimeSum += runTime;
+        task->runTimeMax = std::max(task->runTimeMax, runTime);
+    }
+
+    return -1.0f;
+}
+
+// writes the run times of the scheduler tasks to Log.txt
+static void LogTaskStatistics(void)
+{
+    for (int i = 0; i < TASK_MAX; i++)
+    {
+        if (tasks[i].runs == 0)
+            continue;
+
+        LogFormat(&logQueue, LOG_INFO, NAME_VERSION": Task %s: %ld runs, %.1f us on average, %.1f us at most.\n", tasks[i].name, tasks[i].runs, tasks[i].runTimeSum / tasks[i].runs * 1.0e6, tasks[i].runTimeMax * 1.0e6);
+    }
+}
+
+// task that writes the records of the log queue to Log.txt in one call, plus how many were dropped because the queue
+// was full (the only place that calls XPLMDebugString, always on the sim thread)
+static void FlushLogTask(void)
+{
+    static char batch[LOG_QUEUE_SIZE * LOG_RECORD_SIZE + 128];
+    uint32_t dropped = 0;
+    size_t length = DrainLog(&logQueue, batch, &dropped);
+    if (dropped > 0)
+        snprintf(batch + length, 128, NAME_VERSION": %u log messages were dropped, the log queue was full.\n", dropped);
+
+    if (batch[0] != '\0')
+        XPLM_CALL(XPLMDebugString(batch));
+}
+
+// looks up the datarefs of the binding table: all of them at startup, later (after aircraft or plugins were loaded)
+// only the ones that were not found or whose owner went away, returns the number of datarefs that are available
+static int ResolveDataRefs(int all)
+{
+    int resolved = 0, count = sizeof(dataRefBindings) / sizeof(dataRefBindings[0]);
+    for (int i = 0; i < count; i++)
+    {
+        XPLMDataRef *dataRef = dataRefBindings[i].dataRef;
+        if (all || *dataRef == NULL || !XPLMIsDataRefGood(*dataRef))
+            *dataRef = XPLMFindDataRef(dataRefBindings[i].name);
+        if (*dataRef != NULL)
+            resolved++;
+    }
+
+    return resolved;
+}
+
+// task that takes the snapshot of the sim state for this frame (see BLUfxFrameState_t)
+static void FrameStateTask(void)
+{
+    currentFrameState.xplmCalls = xplmCallCount;
+    xplmCallCount = 0;
+
+    currentFrameState.frame++;
+    currentFrameState.elapsedTime = XPLM_CALL(XPLMGetElapsedTime());
+    XPLM_CALL(XPLMGetScreenSize(&currentFrameState.screenWidth, &currentFrameState.screenHeight));
+    currentFrameState.settingsWindowOpen = (settingsWidget != NULL && XPLM_CALL(XPIsWidgetVisible(settingsWidget))) || (settingsWindow != NULL && XPLM_CALL(XPLMGetWindowIsVisible(settingsWindow)));
+}
 
 // draw-callback that adds post-processing
 static int PostProcessingCallback(XPLMDrawingPhase inPhase, int inIsBefore, void *inRefcon)
 {
-    int x, y;
-    XPLMGetScreenSize(&x, &y);
+    int x = frameState.screenWidth, y = frameState.screenHeight;
 
     if(textureId == 0 || lastResolutionX != x || lastResolutionY != y)
     {
-        XPLMGenerateTextureNumbers((int *) &textureId, 1);
+        XPLM_CALL(XPLMGenerateTextureNumbers((int *) &textureId, 1));
         glActiveTexture(GL_TEXTURE0 + 0);
         glBindTexture(GL_TEXTURE_2D, textureId);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, x, y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
@@ -572,8 +1531,11 @@ static int PostProcessingCallback(XPLMDrawingPhase inPhase, int inIsBefore, void
         glBindTexture(GL_TEXTURE_2D, textureId);
     }
 
+    if (hudEnabled)
+        MarkHudGpuTime(0);
+
     glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, x, y);
-    XPLMSetGraphicsState(0, 1, 0, 0, 0,  0, 0);
+    XPLM_CALL(XPLMSetGraphicsState(0, 1, 0, 0, 0,  0, 0));
 
     glUseProgram(program);
 
@@ -613,6 +1575,19 @@ static int PostProcessingCallback(XPLMDrawingPhase inPhase, int inIsBefore, void
     int sceneLocation = glGetUniformLocation(program, "scene");
     glUniform1i(sceneLocation, 0);
 
+    // the compare view is shown while the settings window is open, in the same pass
+    int compareModeLocation = glGetUniformLocation(program, "compareMode");
+    glUniform1i(compareModeLocation, frameState.settingsWindowOpen ? minMax(0, compareMode, COMPARE_MAX - 1) : COMPARE_OFF);
+
+    // the split is a fraction of the screen width, in the same units as the viewport of the pass (and the drag)
+    int splitLocation = glGetUniformLocation(program, "split");
+    glUniform1f(splitLocation, compareSplit * x);
+
+    float reference[12] = {0.0f};
+    memcpy(reference, comparePinned ? comparePinnedParams : PresetParams(&BLUfxPresets[PRESET_USER]), PARAM_MAX * sizeof(float));
+    int compareParamsLocation = glGetUniformLocation(program, "compareParams");
+    glUniform4fv(compareParamsLocation, 3, reference);
+
     glPushAttrib(GL_VIEWPORT_BIT);
     glMatrixMode(GL_PROJECTION);
     glPushMatrix();
@@ -625,11 +1600,10 @@ static int PostProcessingCallback(XPLMDrawingPhase inPhase, int inIsBefore, void
 
     glColor3f(1.0f, 1.0f, 1.0f);
     glBegin(GL_QUADS);
-    int settingsWindowOpen = XPIsWidgetVisible(settingsWidget);
-    glTexCoord2f((!settingsWindowOpen ? 0.0f : 0.5f), 0.0f);
-    glVertex2f((!settingsWindowOpen ? 0.0f : (GLfloat) (x / 2.0f)), 0.0f);
-    glTexCoord2f((!settingsWindowOpen ? 0.0f : 0.5f), 1.0f);
-    glVertex2f((!settingsWindowOpen ? 0.0f : (GLfloat) (x / 2.0f)), (GLfloat) y);
+    glTexCoord2f(0.0f, 0.0f);
+    glVertex2f(0.0f, 0.0f);
+    glTexCoord2f(0.0f, 1.0f);
+    glVertex2f(0.0f, (GLfloat) y);
     glTexCoord2f(1.0f, 1.0f);
     glVertex2f((GLfloat) x, (GLfloat) y);
     glTexCoord2f(1.0f, 0.0f);
@@ -644,311 +1618,1635 @@ static int PostProcessingCallback(XPLMDrawingPhase inPhase, int inIsBefore, void
 
     glUseProgram(0);
 
+    // the GPU time of the HUD is that of the post-processing pass alone, without the thumbnails
+    if (hudEnabled)
+        MarkHudGpuTime(1);
+
+    // grade the preset thumbnails from this frame's capture while they are shown, at most every THUMBNAIL_INTERVAL
+    if (PresetThumbnailsShown() && (thumbnailsStale || fabsf(frameState.elapsedTime - thumbnailTime) >= THUMBNAIL_INTERVAL))
+        RenderPresetThumbnails(x, y);
+
+    // measure when the frames that include mouse input are done
+    UpdateInputLatency();
+
+    // bound the number of frames the CPU may run ahead of the GPU
+    if (lowLatencyFrames > 0)
+        LimitFramesInFlight();
+
     return 1;
 }
 
-// flightloop-callback that resizes and brings the fake window back to the front if needed
-static float UpdateFakeWindowCallback(float inElapsedSinceLastCall, float inElapsedTimeSinceLastFlightLoop, int inCounter, void *inRefcon)
+// task that polls the bounds of the monitors, which change without a message (e.g. a monitor added or rearranged)
+static void ScreenBoundsTask(void)
 {
-    if (fakeWindow != NULL)
+    int bounds[4] = {0};
+    XPLM_CALL(XPLMGetScreenBoundsGlobal(&bounds[0], &bounds[1], &bounds[2], &bounds[3]));
+    if (memcmp(bounds, layoutScreenBounds, sizeof(bounds)) != 0)
     {
-        int x = 0, y = 0;
-        XPLMGetScreenSize(&x, &y);
-        XPLMSetWindowGeometry(fakeWindow, 0, y, x, 0);
-
-        if (!bringFakeWindowToFront)
-        {
-            XPLMBringWindowToFront(fakeWindow);
-            bringFakeWindowToFront = 1;
-        }
+        memcpy(layoutScreenBounds, bounds, sizeof(bounds));
+        layoutStale = 1;
     }
-    
-    // For good measure, also check to make sure the Settings window is not in a bad place:
+}
+
+// keeps the settings widget reachable: moves it back if less than a few pixels of it are left on the screen
+static void ConstrainSettingsWidget(void)
+{
     // (Note: this allows the user to drag the settings window off the main monitor, but
     // can't actually check to make sure it's still in a legal position if the dimensions
     // of that monitor aren't the same as the main one. However, the window position isn't
     // persistent, so this should be okay in most cases... Otherwise, we could reposition
     // to the default location each time the user hides/re-shows the window.)
-    bool isVisible(settingsWidget && XPIsWidgetVisible(settingsWidget));
-    bool isDragging(isVisible && XPGetWidgetProperty(settingsWidget, xpProperty_Dragging, NULL));
-    if (isVisible && !isDragging) {
-        int screenL = 0, screenT = 0, screenR = 0, screenB = 0;
-        XPLMGetScreenBoundsGlobal(&screenL, &screenT, &screenR, &screenB);
-        
-        int l = 0, t = 0, r = 0, b = 0;
-        XPGetWidgetGeometry(settingsWidget, &l, &t, &r, &b);
-        
-        int nl = l, nt = t, nr = r, nb = b;
-        int w = r - l;
-        int h = t - b;
-        
-        const int MINVIS = 20;              // minimum remaining window visible
-        const int TOPVIS = (MINVIS > 25 ? MINVIS : 25);
-        
-        // Do the jigger jagger:
-        if (l > screenR - MINVIS) {
-            nl = screenR - MINVIS;
-            nr = nl + w;
-        }
-        else if (r < screenL + MINVIS) {
-            nr = screenL + MINVIS;
-            nl = nr - w;
-        }
-        
-        if (t < screenB + MINVIS) {
-            nt = screenB + MINVIS;
-            nb = nt - h;
-        }
-        else if (t > screenT - TOPVIS) {
-            nt = screenT - TOPVIS;
-            nb = nt - h;
-        }
-                
-        // Reposition the window only if necessary based on above:
-        if (nl != l || nr != r || nt != t || nb != b)
-          XPSetWidgetGeometry(settingsWidget, nl, nt, nr, nb);
+    int screenL = layoutScreenBounds[0], screenT = layoutScreenBounds[1], screenR = layoutScreenBounds[2], screenB = layoutScreenBounds[3];
+
+    int l = 0, t = 0, r = 0, b = 0;
+    XPLM_CALL(XPGetWidgetGeometry(settingsWidget, &l, &t, &r, &b));
+
+    int nl = l, nt = t, nr = r, nb = b;
+    int w = r - l;
+    int h = t - b;
+
+    const int MINVIS = 20;              // minimum remaining window visible
+    const int TOPVIS = (MINVIS > 25 ? MINVIS : 25);
+
+    // Do the jigger jagger:
+    if (l > screenR - MINVIS) {
+        nl = screenR - MINVIS;
+        nr = nl + w;
+    }
+    else if (r < screenL + MINVIS) {
+        nr = screenL + MINVIS;
+        nl = nr - w;
     }
 
-    return -1.0f;
+    if (t < screenB + MINVIS) {
+        nt = screenB + MINVIS;
+        nb = nt - h;
+    }
+    else if (t > screenT - TOPVIS) {
+        nt = screenT - TOPVIS;
+        nb = nt - h;
+    }
+
+    // Reposition the window only if necessary based on above:
+    if (nl != l || nr != r || nt != t || nb != b)
+      XPLM_CALL(XPSetWidgetGeometry(settingsWidget, nl, nt, nr, nb));
 }
 
-// lets the thread sleep to achieve the set maximum frame rate
-inline static void LimitFps(float dt)
+// task that recomputes the layout of the fake window and the settings widget once something changed, see
+// SCREEN_BOUNDS_POLL_INTERVAL (in steady state, it makes no XPLM calls at all)
+static void UpdateLayoutTask(void)
 {
-    float t = 1.0f / maxFps - dt;
+    if (frameState.screenWidth != layoutScreenWidth || frameState.screenHeight != layoutScreenHeight)
+    {
+        layoutScreenWidth = frameState.screenWidth;
+        layoutScreenHeight = frameState.screenHeight;
+        layoutStale = 1;
+    }
 
-    if (t > 0.0f)
+    // the settings widget moves with every step of a drag, it is only checked once the drag is over
+    bool settingsWidgetShown = frameState.settingsWindowOpen && settingsWidget != NULL && !modernSettingsWindow;
+    if (settingsWidgetMoved && (!settingsWidgetShown || !XPLM_CALL(XPGetWidgetProperty(settingsWidget, xpProperty_Dragging, NULL))))
     {
-#if IBM
-        DWORD currentTime = timeGetTime();
-        DWORD targetTime = currentTime + (DWORD) (t * 1000.0f);
-        while (currentTime < targetTime)
+        settingsWidgetMoved = 0;
+        layoutStale = 1;
+    }
+
+    if (!layoutStale)
+        return;
+
+    layoutStale = 0;
+    if (fakeWindow != NULL)
+    {
+        XPLM_CALL(XPLMSetWindowGeometry(fakeWindow, 0, layoutScreenHeight, layoutScreenWidth, 0));
+
+        if (!bringFakeWindowToFront)
         {
-            Sleep(0);
-            currentTime = timeGetTime();
+            XPLM_CALL(XPLMBringWindowToFront(fakeWindow));
+            bringFakeWindowToFront = 1;
         }
-#else
-        usleep((useconds_t)(t * 1000000.0f));
-#endif
     }
+
+    if (settingsWidgetShown)
+        ConstrainSettingsWidget();
 }
 
-// flightloop-callback that limits the number of flightcycles
-static float LimiterFlightCallback(float inElapsedSinceLastCall, float inElapsedTimeSinceLastFlightLoop, int inCounter, void *inRefcon)
+// writes the jitter statistics of a pacer to Log.txt at the given level
+static void LogPacerStatistics(const BLUfxPacer *pacer, int level)
 {
-    endTimeFlight = XPLMGetElapsedTime();
-    LimitFps(endTimeFlight - startTimeFlight);
-    startTimeFlight = XPLMGetElapsedTime();
+    if (pacer->pacedFrames == 0)
+        return;
 
-    return -1.0f;
+    double mean = pacer->deviationSum / pacer->pacedFrames;
+    double stddev = sqrt(std::max(0.0, pacer->deviationSquareSum / pacer->pacedFrames - mean * mean));
+
+    LogFormat(&logQueue, level, NAME_VERSION": FPS-Limiter: %ld paced frames, period deviation mean %.0f us, stddev %.0f us, max %.0f us, spin margin %.0f us.\n", pacer->pacedFrames, mean * 1.0e6, stddev * 1.0e6, pacer->deviationMax * 1.0e6, pacer->spinMargin * 1.0e6);
 }
 
-// draw-callback that limits the number of drawcycles
-static int LimiterDrawCallback(XPLMDrawingPhase inPhase, int inIsBefore, void *inRefcon)
+// resets the frame-time statistics of the rolling window and the session
+static void ResetFrameStats(BLUfxFrameStats *stats)
 {
-    endTimeDraw = XPLMGetElapsedTime();
-    LimitFps(endTimeDraw - startTimeDraw);
-    startTimeDraw = XPLMGetElapsedTime();
+    memset(stats, 0, sizeof(*stats));
+    stats->percentiles[0].fraction = 0.50f;
+    stats->percentiles[1].fraction = 0.90f;
+    stats->percentiles[2].fraction = 0.95f;
+    stats->percentiles[3].fraction = 0.99f;
+}
 
-    return 1;
+// returns the histogram bin of a frame time in ms
+static inline int FrameStatsBin(float frameTime)
+{
+    return std::min((int) (frameTime / FRAME_STATS_BIN_WIDTH), FRAME_STATS_BINS - 1);
 }
 
-// flightloop-callback that auto-controls cinema-verite
-static float ControlCinemaVeriteCallback(float inElapsedSinceLastCall, float inElapsedTimeSinceLastFlightLoop, int inCounter, void *inRefcon)
+// moves a percentile cursor after a frame was added to or removed from the given bin of the histogram
+static void UpdatePercentile(BLUfxPercentile *percentile, const unsigned short *bins, int count, int changedBin, int change)
 {
-    // Don't assume this callback should be called, since it could change before the callback is unregistered when the user opts out,
-    // and of course also ignore it if the override flag dataref is set:
-	// TODO: UPDATE THIS TO WORK CORRECTLY IN XP12+ (i.e., use "split datarefs" in XPLM4 world for interior vs. exterior cinema verite equivalents)
-    if (controlCinemaVeriteEnabled && !overrideControlCinemaVerite)
-    {
-        if (XPLMGetDatai(viewTypeDataRef) == 1026) // 3D Cockpit
-        {
-            float elapsedTime = XPLMGetElapsedTime() - lastMouseUsageTime;
+    if (changedBin < percentile->bin)
+        percentile->below += change;
 
-            if (elapsedTime <= disableCinemaVeriteTime)
-                XPLMSetDatai(cinemaVeriteDataRef, 0);
-            else
-                XPLMSetDatai(cinemaVeriteDataRef, 1);
-        }
-        else
-            XPLMSetDatai(cinemaVeriteDataRef, 1);
+    if (count == 0)
+    {
+        percentile->bin = 0;
+        percentile->below = 0;
+        return;
     }
 
-    return -1.0f;
+    // the percentile is the frame of this rank (1-based) in ascending order
+    int rank = std::max(1, (int) ceilf(percentile->fraction * count));
+    while (rank > percentile->below + bins[percentile->bin])
+        percentile->below += bins[percentile->bin++];
+    while (rank <= percentile->below)
+        percentile->below -= bins[--percentile->bin];
 }
 
-// removes the fragment-shader from video memory, if deleteProgram is set the shader-program is also removed
-static void CleanupShader(int deleteProgram = 0)
+// adds (change = 1) or removes (change = -1) a frame time to or from the histogram of the rolling window
+static void UpdateFrameStatsHistogram(BLUfxFrameStats *stats, float frameTime, int change)
 {
-    glDetachShader(program, fragmentShader);
-    glDeleteShader(fragmentShader);
+    int bin = FrameStatsBin(frameTime);
+    stats->bins[bin] += change;
+    stats->binSums[bin] += change * frameTime;
+    for (int i = 0; i < FRAME_STATS_PERCENTILES; i++)
+        UpdatePercentile(&stats->percentiles[i], stats->bins, stats->count, bin, change);
+}
 
-    if (deleteProgram)
+// records the time of one frame in ms, replacing the oldest one in the rolling window
+static void RecordFrameTime(BLUfxFrameStats *stats, float frameTime)
+{
+    if (stats->count == FRAME_STATS_WINDOW)
+    {
+        float oldest = stats->frameTimes[stats->next];
+        stats->count--;
+        stats->sum -= oldest;
+        UpdateFrameStatsHistogram(stats, oldest, -1);
+    }
+
+    stats->frameTimes[stats->next] = frameTime;
+    stats->next = (stats->next + 1) % FRAME_STATS_WINDOW;
+    stats->count++;
+    stats->sum += frameTime;
+    UpdateFrameStatsHistogram(stats, frameTime, 1);
+
+    stats->sessionBins[FrameStatsBin(frameTime)]++;
+    stats->sessionFrames++;
+    stats->sessionSum += frameTime;
+    stats->sessionMax = std::max(stats->sessionMax, (double) frameTime);
+}
+
+// returns the upper edge of the histogram bin, in ms, which holds the frame of the given percentile
+static float HistogramPercentile(const unsigned int *bins, long count, float fraction)
+{
+    long rank = std::max(1L, (long) ceil(fraction * count)), below = 0;
+    int bin = 0;
+    while (bin < FRAME_STATS_BINS - 1 && below + (long) bins[bin] < rank)
+        below += bins[bin++];
+
+    return (bin + 1) * FRAME_STATS_BIN_WIDTH;
+}
+
+// returns the rate of the slowest 1% of the frames in the rolling window (mean of their frame times, as fps)
+static float FrameStatsOnePercentLow(const BLUfxFrameStats *stats)
+{
+    int slowest = std::max(1, stats->count / 100), frames = 0;
+    double sum = 0.0;
+    for (int bin = FRAME_STATS_BINS - 1; bin >= 0 && frames < slowest; bin--)
+    {
+        if (stats->bins[bin] == 0)
+            continue;
+
+        // whole bins are taken at their actual sum, a partial bin at its mean
+        int taken = std::min((int) stats->bins[bin], slowest - frames);
+        sum += stats->binSums[bin] * taken / stats->bins[bin];
+        frames += taken;
+    }
+
+    return sum > 0.0 ? (float) (1000.0 * frames / sum) : 0.0f;
+}
+
+// returns a statistic of the rolling window (see BLUfxStats_t)
+static float GetFrameStat(const BLUfxFrameStats *stats, int stat)
+{
+    if (stats->count == 0)
+        return 0.0f;
+
+    switch (stat)
+    {
+        case STAT_FRAME_TIME_P50:
+        case STAT_FRAME_TIME_P90:
+        case STAT_FRAME_TIME_P95:
+        case STAT_FRAME_TIME_P99:
+            return (stats->percentiles[stat - STAT_FRAME_TIME_P50].bin + 1) * FRAME_STATS_BIN_WIDTH;
+        case STAT_FPS_AVERAGE:
+            return (float) (1000.0 * stats->count / stats->sum);
+        case STAT_FPS_1_PERCENT_LOW:
+            return FrameStatsOnePercentLow(stats);
+    }
+
+    return 0.0f;
+}
+
+// writes the frame-time statistics of the session to Log.txt
+static void LogFrameStats(const BLUfxFrameStats *stats)
+{
+    if (stats->sessionFrames == 0)
+        return;
+
+    LogFormat(&logQueue, LOG_INFO, NAME_VERSION": Frame times: %ld frames, average %.2f ms (%.1f fps), p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, max %.1f ms.\n", stats->sessionFrames, stats->sessionSum / stats->sessionFrames, 1000.0 * stats->sessionFrames / stats->sessionSum, HistogramPercentile(stats->sessionBins, stats->sessionFrames, 0.50f), HistogramPercentile(stats->sessionBins, stats->sessionFrames, 0.95f), HistogramPercentile(stats->sessionBins, stats->sessionFrames, 0.99f), stats->sessionMax);
+}
+
+// looks up the timer query functions (GL 3.3 / ARB_timer_query), returns false if they are not available
+static bool LoadTimerQueryFunctions(void)
+{
+    if (timerQueryFunctionsLoaded == 0)
+    {
+        glGenQueriesProc = (BLUfxGenQueriesProc) GetGLProcAddress("glGenQueries");
+        glDeleteQueriesProc = (BLUfxDeleteQueriesProc) GetGLProcAddress("glDeleteQueries");
+        glQueryCounterProc = (BLUfxQueryCounterProc) GetGLProcAddress("glQueryCounter");
+        glGetQueryObjectivProc = (BLUfxGetQueryObjectivProc) GetGLProcAddress("glGetQueryObjectiv");
+        glGetQueryObjectui64vProc = (BLUfxGetQueryObjectui64vProc) GetGLProcAddress("glGetQueryObjectui64v");
+        glGetInteger64vProc = (BLUfxGetInteger64vProc) GetGLProcAddress("glGetInteger64v");
+        timerQueryFunctionsLoaded = glGenQueriesProc != NULL && glDeleteQueriesProc != NULL && glQueryCounterProc != NULL && glGetQueryObjectivProc != NULL && glGetQueryObjectui64vProc != NULL && glGetInteger64vProc != NULL ? 1 : -1;
+        if (timerQueryFunctionsLoaded > 0)
+            glGenQueriesProc(LATENCY_MAX_PROBES, latencyQueries);
+    }
+
+    return timerQueryFunctionsLoaded > 0;
+}
+
+// records the latencies of the probes whose frames are done (oldest first, without waiting)
+static void PollLatencyProbes(void)
+{
+    while (latencyProbeCount > 0)
+    {
+        BLUfxLatencyProbe *probe = &latencyProbes[latencyProbeFirst];
+        double completionTime;
+        if (probe->query != 0)
+        {
+            GLint available = 0;
+            glGetQueryObjectivProc(probe->query, BLUFX_GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+
+            BLUfxGLuint64 gpuTime = 0;
+            glGetQueryObjectui64vProc(probe->query, BLUFX_GL_QUERY_RESULT, &gpuTime);
+            completionTime = gpuTime * 1.0e-9 + gpuClockOffset;
+        }
+        else
+        {
+            GLenum status = glClientWaitSyncProc(probe->fence, 0, 0);
+            if (status != BLUFX_GL_ALREADY_SIGNALED && status != BLUFX_GL_CONDITION_SATISFIED)
+                break;
+
+            glDeleteSyncProc(probe->fence);
+            completionTime = GetMonotonicTime();
+        }
+
+        float latency = (float) ((completionTime - probe->inputTime) * 1000.0);
+        if (latency > 0.0f && latency < FRAME_STATS_MAX_FRAME_TIME)
+            RecordFrameTime(&latencyStats, latency);
+
+        latencyProbeFirst = (latencyProbeFirst + 1) % LATENCY_MAX_PROBES;
+        latencyProbeCount--;
+    }
+}
+
+// collects finished latency probes and starts one for this frame if it includes new input, called after the pass
+static void UpdateInputLatency(void)
+{
+    if (latencyProbeCount > 0)
+        PollLatencyProbes();
+
+    if (pendingInputTime == 0.0 || latencyProbeCount == LATENCY_MAX_PROBES)
+        return;
+
+    BLUfxLatencyProbe *probe = &latencyProbes[(latencyProbeFirst + latencyProbeCount) % LATENCY_MAX_PROBES];
+    probe->inputTime = pendingInputTime;
+    probe->query = 0;
+    probe->fence = NULL;
+    if (LoadTimerQueryFunctions())
+    {
+        // the GPU clock is mapped to the monotonic clock by reading both at (nearly) the same time
+        double now = GetMonotonicTime();
+        if (now >= gpuClockCalibrationTime + LATENCY_CALIBRATION_INTERVAL)
+        {
+            BLUfxGLint64 gpuTime = 0;
+            glGetInteger64vProc(BLUFX_GL_TIMESTAMP, &gpuTime);
+            gpuClockCalibrationTime = GetMonotonicTime();
+            gpuClockOffset = gpuClockCalibrationTime - gpuTime * 1.0e-9;
+        }
+
+        probe->query = latencyQueries[(latencyProbeFirst + latencyProbeCount) % LATENCY_MAX_PROBES];
+        glQueryCounterProc(probe->query, BLUFX_GL_TIMESTAMP);
+    }
+    else if (LoadSyncFunctions())
+        probe->fence = glFenceSyncProc(BLUFX_GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    else
+        return;
+
+    latencyProbeCount++;
+    pendingInputTime = 0.0;
+}
+
+// deletes the latency probes and queries, and writes the input latencies of the session to Log.txt
+static void ReleaseLatencyProbes(void)
+{
+    for (int i = 0; i < latencyProbeCount; i++)
+    {
+        BLUfxLatencyProbe *probe = &latencyProbes[(latencyProbeFirst + i) % LATENCY_MAX_PROBES];
+        if (probe->fence != NULL)
+            glDeleteSyncProc(probe->fence);
+    }
+    latencyProbeFirst = latencyProbeCount = 0;
+
+    if (timerQueryFunctionsLoaded > 0)
+        glDeleteQueriesProc(LATENCY_MAX_PROBES, latencyQueries);
+    timerQueryFunctionsLoaded = 0;
+
+    if (latencyStats.sessionFrames == 0)
+        return;
+
+    LogFormat(&logQueue, LOG_INFO, NAME_VERSION": Input latency: %ld samples, average %.1f ms, p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, max %.1f ms.\n", latencyStats.sessionFrames, latencyStats.sessionSum / latencyStats.sessionFrames, HistogramPercentile(latencyStats.sessionBins, latencyStats.sessionFrames, 0.50f), HistogramPercentile(latencyStats.sessionBins, latencyStats.sessionFrames, 0.95f), HistogramPercentile(latencyStats.sessionBins, latencyStats.sessionFrames, 0.99f), latencyStats.sessionMax);
+}
+
+// compiles a shader from a header (version and defines) and a body, returns 0 and logs why if that fails
+static GLuint CompileShader(GLenum type, const char *name, const char *header, const char *body)
+{
+    const char *strings[2] = {header, body};
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 2, strings, 0);
+    glCompileShader(shader);
+    GLint isShaderCompiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &isShaderCompiled);
+    if (isShaderCompiled == GL_FALSE)
+    {
+        GLsizei maxLength = 2048;
+        GLchar *log = new GLchar[maxLength];
+        glGetShaderInfoLog(shader, maxLength, &maxLength, log);
+        LogFormat(&logQueue, LOG_ERROR, NAME_VERSION": The following error occured while compiling the %s:\n" NAME_VERSION_BLANK, name);  // indent to align where possible
+        LogWrite(&logQueue, LOG_ERROR, log);
+        delete[] log;
+
+        glDeleteShader(shader);
+
+        return 0;
+    }
+
+    return shader;
+}
+
+// links a program of a vertex shader (NULL = fixed function) and a fragment shader, returns 0 and logs why if that fails
+static GLuint LinkShaderProgram(const char *name, const char *header, const char *vertexShaderString, const char *fragmentShaderString)
+{
+    GLuint vertex = (vertexShaderString != NULL ? CompileShader(GL_VERTEX_SHADER, name, header, vertexShaderString) : 0);
+    GLuint fragment = CompileShader(GL_FRAGMENT_SHADER, name, header, fragmentShaderString);
+    GLuint linked = 0;
+
+    if ((vertexShaderString == NULL || vertex != 0) && fragment != 0)
+    {
+        linked = glCreateProgram();
+        if (vertex != 0)
+            glAttachShader(linked, vertex);
+        glAttachShader(linked, fragment);
+        glLinkProgram(linked);
+        GLint isProgramLinked = GL_FALSE;
+        glGetProgramiv(linked, GL_LINK_STATUS, &isProgramLinked);
+        if (isProgramLinked == GL_FALSE)
+        {
+            GLsizei maxLength = 2048;
+            GLchar *log = new GLchar[maxLength];
+            glGetProgramInfoLog(linked, maxLength, &maxLength, log);
+            LogFormat(&logQueue, LOG_ERROR, NAME_VERSION": The following error occured while linking the %s:\n" NAME_VERSION_BLANK, name);  // indent to align where possible
+            LogWrite(&logQueue, LOG_ERROR, log);
+            delete[] log;
+
+            glDeleteProgram(linked);
+            linked = 0;
+        }
+    }
+
+    // the shaders are only flagged for deletion while they are attached to the program
+    if (vertex != 0)
+        glDeleteShader(vertex);
+    if (fragment != 0)
+        glDeleteShader(fragment);
+
+    return linked;
+}
+
+// deletes the programs, textures and buffers of the preset thumbnails, which are set up again when next shown
+static void ReleasePresetThumbnails(void)
+{
+    if (thumbnailProgram != 0)
+        glDeleteProgram(thumbnailProgram);
+    if (downsampleProgram != 0)
+        glDeleteProgram(downsampleProgram);
+    if (thumbnailParamBuffer != 0)
+        glDeleteBuffers(1, &thumbnailParamBuffer);
+    if (thumbnailFramebuffer != 0)
+        glDeleteFramebuffersProc(1, &thumbnailFramebuffer);
+    if (thumbnailSceneTexture != 0)
+        glDeleteTextures(1, (GLuint *) &thumbnailSceneTexture);
+    if (thumbnailAtlasTexture != 0)
+        glDeleteTextures(1, (GLuint *) &thumbnailAtlasTexture);
+    thumbnailProgram = downsampleProgram = thumbnailParamBuffer = thumbnailFramebuffer = 0;
+    thumbnailSceneTexture = thumbnailAtlasTexture = 0;
+    thumbnailMode = THUMBNAILS_NOT_INITIALIZED;
+    thumbnailsStale = 1;
+}
+
+// sets up the preset thumbnails when first shown: looks up the framebuffer functions (and those for instancing and
+// uniform buffers), builds the shaders and creates the small scene texture and the atlas, returns false if thumbnails
+// are not available
+static bool InitPresetThumbnails(void)
+{
+    if (thumbnailMode != THUMBNAILS_NOT_INITIALIZED)
+        return thumbnailMode != THUMBNAILS_UNAVAILABLE;
+
+#if APL
+    glGenFramebuffersProc = (BLUfxGenFramebuffersProc) GetGLProcAddress("glGenFramebuffersEXT");
+    glDeleteFramebuffersProc = (BLUfxDeleteFramebuffersProc) GetGLProcAddress("glDeleteFramebuffersEXT");
+    glBindFramebufferProc = (BLUfxBindFramebufferProc) GetGLProcAddress("glBindFramebufferEXT");
+    glFramebufferTexture2DProc = (BLUfxFramebufferTexture2DProc) GetGLProcAddress("glFramebufferTexture2DEXT");
+    glCheckFramebufferStatusProc = (BLUfxCheckFramebufferStatusProc) GetGLProcAddress("glCheckFramebufferStatusEXT");
+    glDrawArraysInstancedProc = (BLUfxDrawArraysInstancedProc) GetGLProcAddress("glDrawArraysInstancedARB");
+#else
+    glGenFramebuffersProc = (BLUfxGenFramebuffersProc) GetGLProcAddress("glGenFramebuffers");
+    glDeleteFramebuffersProc = (BLUfxDeleteFramebuffersProc) GetGLProcAddress("glDeleteFramebuffers");
+    glBindFramebufferProc = (BLUfxBindFramebufferProc) GetGLProcAddress("glBindFramebuffer");
+    glFramebufferTexture2DProc = (BLUfxFramebufferTexture2DProc) GetGLProcAddress("glFramebufferTexture2D");
+    glCheckFramebufferStatusProc = (BLUfxCheckFramebufferStatusProc) GetGLProcAddress("glCheckFramebufferStatus");
+    glDrawArraysInstancedProc = (BLUfxDrawArraysInstancedProc) GetGLProcAddress("glDrawArraysInstanced");
+#endif
+    glGetUniformBlockIndexProc = (BLUfxGetUniformBlockIndexProc) GetGLProcAddress("glGetUniformBlockIndex");
+    glUniformBlockBindingProc = (BLUfxUniformBlockBindingProc) GetGLProcAddress("glUniformBlockBinding");
+    glBindBufferBaseProc = (BLUfxBindBufferBaseProc) GetGLProcAddress("glBindBufferBase");
+
+    thumbnailMode = THUMBNAILS_UNAVAILABLE;
+    if (glGenFramebuffersProc == NULL || glDeleteFramebuffersProc == NULL || glBindFramebufferProc == NULL || glFramebufferTexture2DProc == NULL || glCheckFramebufferStatusProc == NULL)
+    {
+        LogWrite(&logQueue, LOG_WARNING, NAME_VERSION": Preset thumbnails are not available, the OpenGL driver has no framebuffer objects.\n");
+        return false;
+    }
+
+    // one instanced draw for all tiles if possible, else one draw per tile
+    if (glDrawArraysInstancedProc != NULL && glGetUniformBlockIndexProc != NULL && glUniformBlockBindingProc != NULL && glBindBufferBaseProc != NULL)
+    {
+        thumbnailProgram = LinkShaderProgram("instanced thumbnail shader", THUMBNAIL_INSTANCED_SHADER_HEADER, THUMBNAIL_VERTEX_SHADER, THUMBNAIL_FRAGMENT_SHADER);
+        GLuint block = (thumbnailProgram != 0 ? glGetUniformBlockIndexProc(thumbnailProgram, "PresetParams") : BLUFX_GL_INVALID_INDEX);
+        if (block != BLUFX_GL_INVALID_INDEX)
+        {
+            glUniformBlockBindingProc(thumbnailProgram, block, 0);
+            glGenBuffers(1, &thumbnailParamBuffer);
+            thumbnailMode = THUMBNAILS_INSTANCED;
+        }
+        else if (thumbnailProgram != 0)
+        {
+            glDeleteProgram(thumbnailProgram);
+            thumbnailProgram = 0;
+        }
+    }
+    if (thumbnailProgram == 0)
+    {
+        thumbnailProgram = LinkShaderProgram("thumbnail shader", THUMBNAIL_SHADER_HEADER, THUMBNAIL_VERTEX_SHADER, THUMBNAIL_FRAGMENT_SHADER);
+        thumbnailMode = THUMBNAILS_PER_TILE;
+    }
+    downsampleProgram = LinkShaderProgram("downsampling shader", "", NULL, DOWNSAMPLE_SHADER);
+
+    // the small texture holds the downsampled scene at twice the resolution of a tile
+    int textures[2];
+    XPLM_CALL(XPLMGenerateTextureNumbers(textures, 2));
+    thumbnailSceneTexture = textures[0];
+    thumbnailAtlasTexture = textures[1];
+    for (int i = 0; i < 2; i++)
+    {
+        XPLM_CALL(XPLMBindTexture2d(textures[i], 0));
+        if (i == 0)
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 2 * THUMBNAIL_WIDTH, 2 * THUMBNAIL_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        else
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, THUMBNAIL_COLUMNS * THUMBNAIL_WIDTH, THUMBNAIL_ROWS * THUMBNAIL_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    // the atlas starts out black, until the first thumbnails are drawn into it
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(BLUFX_GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGenFramebuffersProc(1, &thumbnailFramebuffer);
+    glBindFramebufferProc(BLUFX_GL_FRAMEBUFFER, thumbnailFramebuffer);
+    glFramebufferTexture2DProc(BLUFX_GL_FRAMEBUFFER, BLUFX_GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, thumbnailAtlasTexture, 0);
+    bool complete = glCheckFramebufferStatusProc(BLUFX_GL_FRAMEBUFFER) == BLUFX_GL_FRAMEBUFFER_COMPLETE;
+    if (complete)
+    {
+        glPushAttrib(GL_COLOR_BUFFER_BIT | GL_SCISSOR_BIT);
+        glDisable(GL_SCISSOR_TEST);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glPopAttrib();
+    }
+    glBindFramebufferProc(BLUFX_GL_FRAMEBUFFER, (GLuint) previousFramebuffer);
+
+    if (thumbnailProgram == 0 || downsampleProgram == 0 || !complete)
+    {
+        LogWrite(&logQueue, LOG_WARNING, NAME_VERSION": Preset thumbnails are not available, see the errors above (or the thumbnail atlas can't be drawn to).\n");
+        ReleasePresetThumbnails();
+        thumbnailMode = THUMBNAILS_UNAVAILABLE;
+        return false;
+    }
+
+    LogWrite(&logQueue, LOG_INFO, thumbnailMode == THUMBNAILS_INSTANCED ? NAME_VERSION": Preset thumbnails are drawn with one instanced draw.\n" : NAME_VERSION": Preset thumbnails are drawn with one draw per tile (no instancing or uniform buffers).\n");
+
+    return true;
+}
+
+// returns whether the preset thumbnails are shown in the settings window (and so have to be kept up to date)
+static inline bool PresetThumbnailsShown(void)
+{
+    return presetThumbnailsEnabled && modernSettingsWindow && settingsWindow != NULL && frameState.settingsWindowOpen && thumbnailMode != THUMBNAILS_UNAVAILABLE;
+}
+
+// grades the presets of the current catalog page into the tiles of the thumbnail atlas, from the scene just captured
+// into textureId (called by the post-processing pass after it has drawn the graded scene, the capture is ungraded)
+static void RenderPresetThumbnails(int sceneWidth, int sceneHeight)
+{
+    if (!InitPresetThumbnails())
+        return;
+
+    thumbnailTime = frameState.elapsedTime;
+    thumbnailsStale = 0;
+
+    // 3 vec4s of parameters per tile, laid out as in the uniform block (std140), on-disk presets are loaded when first shown
+    static float params[THUMBNAIL_PARAM_VECTORS * 4];
+    int tileCount = 0;
+    memset(params, 0, sizeof(params));
+    for (int i = 0; i < PRESET_PAGE_SIZE; i++)
+    {
+        size_t index = presetCatalogPage * PRESET_PAGE_SIZE + i;
+        const BLUfxPreset *preset = (index < presetCatalogView.size() ? LoadCatalogPreset(&presetCatalog[presetCatalogView[index]]) : NULL);
+        thumbnailEntries[i] = (preset != NULL ? presetCatalogView[index] : -1);
+        if (preset != NULL)
+        {
+            memcpy(params + i * 12, PresetParams(preset), PARAM_MAX * sizeof(float));
+            tileCount = i + 1;
+        }
+    }
+
+    // the tiles are wider than the screen, so they show its middle band
+    float band = std::min(1.0f, (float) sceneWidth / (float) sceneHeight * THUMBNAIL_HEIGHT / THUMBNAIL_WIDTH);
+
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(BLUFX_GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glPushAttrib(GL_VIEWPORT_BIT | GL_SCISSOR_BIT);
+    glDisable(GL_SCISSOR_TEST);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glBindFramebufferProc(BLUFX_GL_FRAMEBUFFER, thumbnailFramebuffer);
+
+    // downsample the scene once...
+    glFramebufferTexture2DProc(BLUFX_GL_FRAMEBUFFER, BLUFX_GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, thumbnailSceneTexture, 0);
+    glViewport(0, 0, 2 * THUMBNAIL_WIDTH, 2 * THUMBNAIL_HEIGHT);
+    glUseProgram(downsampleProgram);
+    glUniform1i(glGetUniformLocation(downsampleProgram, "scene"), 0);
+    glUniform2f(glGetUniformLocation(downsampleProgram, "footprint"), 1.0f / (2 * THUMBNAIL_WIDTH), band / (2 * THUMBNAIL_HEIGHT));
+    XPLM_CALL(XPLMBindTexture2d(textureId, 0));
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, 0.5f - band / 2.0f);
+    glVertex2f(-1.0f, -1.0f);
+    glTexCoord2f(0.0f, 0.5f + band / 2.0f);
+    glVertex2f(-1.0f, 1.0f);
+    glTexCoord2f(1.0f, 0.5f + band / 2.0f);
+    glVertex2f(1.0f, 1.0f);
+    glTexCoord2f(1.0f, 0.5f - band / 2.0f);
+    glVertex2f(1.0f, -1.0f);
+    glEnd();
+
+    // ...and grade all tiles from the small texture
+    glFramebufferTexture2DProc(BLUFX_GL_FRAMEBUFFER, BLUFX_GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, thumbnailAtlasTexture, 0);
+    glViewport(0, 0, THUMBNAIL_COLUMNS * THUMBNAIL_WIDTH, THUMBNAIL_ROWS * THUMBNAIL_HEIGHT);
+    glUseProgram(thumbnailProgram);
+    glUniform1i(glGetUniformLocation(thumbnailProgram, "scene"), 0);
+    glUniform2f(glGetUniformLocation(thumbnailProgram, "tiles"), (float) THUMBNAIL_COLUMNS, (float) THUMBNAIL_ROWS);
+    glUniform1f(glGetUniformLocation(thumbnailProgram, "band"), band);
+    XPLM_CALL(XPLMBindTexture2d(thumbnailSceneTexture, 0));
+
+    static const GLfloat quad[8] = {0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, quad);
+    if (thumbnailMode == THUMBNAILS_INSTANCED)
+    {
+        glBindBuffer(BLUFX_GL_UNIFORM_BUFFER, thumbnailParamBuffer);
+        glBufferData(BLUFX_GL_UNIFORM_BUFFER, sizeof(params), params, GL_DYNAMIC_DRAW);
+        glBindBufferBaseProc(BLUFX_GL_UNIFORM_BUFFER, 0, thumbnailParamBuffer);
+        glDrawArraysInstancedProc(GL_TRIANGLE_STRIP, 0, 4, tileCount);
+        glBindBuffer(BLUFX_GL_UNIFORM_BUFFER, 0);
+    }
+    else
+    {
+        int tileLocation = glGetUniformLocation(thumbnailProgram, "tile");
+        int paramsLocation = glGetUniformLocation(thumbnailProgram, "presetParams");
+        for (int i = 0; i < tileCount; i++)
+        {
+            glUniform1f(tileLocation, (float) i);
+            glUniform4fv(paramsLocation, 3, params + i * 12);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        }
+    }
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glUseProgram(0);
+
+    glBindFramebufferProc(BLUFX_GL_FRAMEBUFFER, (GLuint) previousFramebuffer);
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glPopAttrib();
+}
+
+// task that measures the time between the starts of consecutive frames
+static void FrameStatsTask(void)
+{
+    double now = GetMonotonicTime();
+    if (frameStats.lastFrameStart != 0.0)
+    {
+        float frameTime = (float) ((now - frameStats.lastFrameStart) * 1000.0);
+        if (frameTime < FRAME_STATS_MAX_FRAME_TIME)
+            RecordFrameTime(&frameStats, frameTime);
+    }
+    frameStats.lastFrameStart = now;
+}
+
+// returns the highest divisor of the refresh rate (refreshRate / n) that doesn't exceed the given frame rate, but
+// not less than ADAPTIVE_FPS_MIN_FPS (as long as the refresh rate allows for that)
+static float RefreshRateStep(float fps)
+{
+    int divisor = 1;
+    while (refreshRate / divisor > fps && refreshRate / (divisor + 1) >= ADAPTIVE_FPS_MIN_FPS)
+        divisor++;
+
+    return refreshRate / divisor;
+}
+
+// returns the frame rate the limiter currently caps to, which is the lowest of the FPS-Limiter setting, the cap of the
+// current sim context (paused or replay) and the caps of the host power state (on battery, hot), 0 if none applies
+static float GetFpsCap(void)
+{
+    float fps = 0.0f;
+    if (fpsLimiterEnabled)
+        fps = adaptiveFpsEnabled && adaptiveFps > 0.0f ? adaptiveFps : maxFps;
+
+    float contextFps[3] = {simContext == SIM_CONTEXT_PAUSED ? pausedFps : simContext == SIM_CONTEXT_REPLAY ? replayFps : 0.0f, (powerState & POWER_ON_BATTERY) ? batteryFps : 0.0f, (powerState & POWER_HOT) ? hotFps : 0.0f};
+    for (int i = 0; i < 3; i++)
+    {
+        if (contextFps[i] > 0.0f && (fps == 0.0f || contextFps[i] < fps))
+            fps = contextFps[i];
+    }
+
+    return fps;
+}
+
+// starts over with the highest cap (maxFps rounded down to the refresh rate), e.g. when the limiter is switched on
+static void ResetAdaptiveFps(void)
+{
+    ResetFrameStats(&workStats);
+    limiterFrameStart = 0.0;
+    adaptiveFpsEvaluationTime = GetMonotonicTime();
+    adaptiveFps = RefreshRateStep(maxFps);
+    adaptiveFpsRaiseIntervals = 0;
+}
+
+// re-evaluates the adaptive cap from the recent unconstrained frame times (see ADAPTIVE_FPS_INTERVAL)
+static void UpdateAdaptiveFps(void)
+{
+    if (workStats.count < ADAPTIVE_FPS_MIN_FRAMES)
+        return;
+
+    float sustainableFps = 1000.0f / GetFrameStat(&workStats, STAT_FRAME_TIME_P90);
+    float previousFps = adaptiveFps;
+
+    float fps = RefreshRateStep(std::min(sustainableFps, maxFps));
+    if (fps < adaptiveFps)
+    {
+        adaptiveFps = fps;
+        adaptiveFpsRaiseIntervals = 0;
+    }
+    else if (RefreshRateStep(std::min(sustainableFps / ADAPTIVE_FPS_HEADROOM, maxFps)) > adaptiveFps)
+    {
+        if (++adaptiveFpsRaiseIntervals >= ADAPTIVE_FPS_RAISE_INTERVALS)
+        {
+            adaptiveFps = RefreshRateStep(std::min(sustainableFps / ADAPTIVE_FPS_HEADROOM, maxFps));
+            adaptiveFpsRaiseIntervals = 0;
+        }
+    }
+    else
+        adaptiveFpsRaiseIntervals = 0;
+
+    if (adaptiveFps != previousFps && frameState.settingsWindowOpen)
+        UpdateSettingsWidgets();
+}
+
+// task that limits the frame rate: this is the only place the limiter measures and sleeps, once per frame as the
+// first task of the scheduler, so the measured period is the full frame (flight model and drawing)
+static void LimiterTask(void)
+{
+    // the time since the end of the last wait is what the frame took without the limiter (only flying frames count)
+    double now = GetMonotonicTime();
+    if (simContext == SIM_CONTEXT_FLYING && limiterFrameStart != 0.0 && (now - limiterFrameStart) * 1000.0 < FRAME_STATS_MAX_FRAME_TIME)
+        RecordFrameTime(&workStats, (float) ((now - limiterFrameStart) * 1000.0));
+
+    if (fpsLimiterEnabled && adaptiveFpsEnabled && simContext == SIM_CONTEXT_FLYING && now >= adaptiveFpsEvaluationTime + ADAPTIVE_FPS_INTERVAL)
+    {
+        adaptiveFpsEvaluationTime = now;
+        UpdateAdaptiveFps();
+    }
+
+    LimitFps(&limiterPacer, GetFpsCap());
+    limiterFrameStart = GetMonotonicTime();
+    limiterSleepTime = (float) ((limiterFrameStart - now) * 1000.0);
+}
+
+// adds or removes the limiter task (and switches the timer resolution) when the limiter is enabled or disabled
+static void SetLimiterActive(int active)
+{
+    if (schedulerFlightLoop == NULL)
+        return;
+
+    limiterActive = active;
+    if (active)
+    {
+        limiterSessionEnabled = fpsLimiterEnabled;
+        ResetPacer(&limiterPacer);
+        ResetAdaptiveFps();
+#if IBM
+        timeBeginPeriod(1);
+#endif
+        SetTaskActive(TASK_LIMITER, 1);
+    }
+    else
+    {
+        SetTaskActive(TASK_LIMITER, 0);
+
+        // only a session of the FPS-Limiter is worth an info line, not every pause or replay with a cap of its own
+        LogPacerStatistics(&limiterPacer, limiterSessionEnabled ? LOG_INFO : LOG_DEBUG);
+        limiterSleepTime = 0.0f;
+#if IBM
+        timeEndPeriod(1);
+#endif
+    }
+}
+
+// runs the limiter task while some cap applies (FPS-Limiter or the cap of the current sim context), so that there is
+// no per-frame work at all otherwise
+static void UpdateLimiterActive(void)
+{
+    if (limiterActive && fpsLimiterEnabled)
+        limiterSessionEnabled = 1;
+
+    int active = GetFpsCap() > 0.0f;
+    if (active != limiterActive)
+        SetLimiterActive(active);
+}
+
+// task that polls whether the sim is paused or in replay and picks up the host power state, only active if one of
+// them has a cap
+static void SimContextTask(void)
+{
+    int context = SIM_CONTEXT_FLYING;
+    if (replayDataRef != NULL && XPLM_CALL(XPLMGetDatai(replayDataRef)))
+        context = SIM_CONTEXT_REPLAY;
+    else if (pausedDataRef != NULL && XPLM_CALL(XPLMGetDatai(pausedDataRef)))
+        context = SIM_CONTEXT_PAUSED;
+
+    int state = hostPowerState.load();
+    if (context != simContext || state != powerState)
+    {
+        if (context != simContext)
+            limiterFrameStart = 0.0;    // the next frame is not comparable to the last one of the previous context
+        simContext = context;
+        powerState = state;
+        UpdateLimiterActive();
+    }
+}
+
+// returns whether the split interior/exterior cinema verite datarefs of X-Plane 12 are available
+static inline bool HasSplitCinemaVerite(void)
+{
+    return interiorCinemaVeriteDataRef != NULL && exteriorCinemaVeriteDataRef != NULL;
+}
+
+// writes a cinema verite dataref, but only if the value differs from the one it was last written (or read back) with
+static void WriteCinemaVerite(XPLMDataRef dataRef, int *written, int value)
+{
+    if (dataRef != NULL && *written != value)
+    {
+        XPLM_CALL(XPLMSetDatai(dataRef, value));
+        *written = value;
+    }
+}
+
+// returns whether the view type has to be polled for the cinema verite control (only with the single legacy dataref)
+static inline bool NeedsCinemaVeriteTask(void)
+{
+    return controlCinemaVeriteEnabled && !HasSplitCinemaVerite() && viewTypeDataRef != NULL;
+}
+
+// writes the cinema verite datarefs for the current state (mouse in use, view type), if they changed
+static void UpdateCinemaVerite(void)
+{
+    // Don't assume we should control it, since the user could have opted out, and of course also ignore it if the
+    // override flag dataref is set:
+    if (!controlCinemaVeriteEnabled || overrideControlCinemaVerite)
+        return;
+
+    if (HasSplitCinemaVerite())
+    {
+        WriteCinemaVerite(interiorCinemaVeriteDataRef, &interiorCinemaVeriteWritten, !mouseInUse);
+        WriteCinemaVerite(exteriorCinemaVeriteDataRef, &exteriorCinemaVeriteWritten, 1);
+    }
+    else
+        WriteCinemaVerite(cinemaVeriteDataRef, &cinemaVeriteWritten, viewType == VIEW_TYPE_3D_COCKPIT ? !mouseInUse : 1);
+}
+
+// reads back the cinema verite datarefs, which the user or other plugins may have written while BLU-fx didn't control
+// them (at startup, when the control is switched on and when an override ends)
+static void ReadBackCinemaVerite(void)
+{
+    cinemaVeriteWritten = (cinemaVeriteDataRef != NULL ? XPLM_CALL(XPLMGetDatai(cinemaVeriteDataRef)) : -1);
+    interiorCinemaVeriteWritten = (interiorCinemaVeriteDataRef != NULL ? XPLM_CALL(XPLMGetDatai(interiorCinemaVeriteDataRef)) : -1);
+    exteriorCinemaVeriteWritten = (exteriorCinemaVeriteDataRef != NULL ? XPLM_CALL(XPLMGetDatai(exteriorCinemaVeriteDataRef)) : -1);
+}
+
+// reads the view type and the datarefs and writes them for the current state, e.g. when the control is switched on
+static void RefreshCinemaVerite(void)
+{
+    if (viewTypeDataRef != NULL)
+        viewType = XPLM_CALL(XPLMGetDatai(viewTypeDataRef));
+    ReadBackCinemaVerite();
+    UpdateCinemaVerite();
+}
+
+// task that polls the view type for the cinema verite control, only active if NeedsCinemaVeriteTask
+static void ControlCinemaVeriteTask(void)
+{
+    if (viewTypeDataRef == NULL)
+        return;
+
+    int type = XPLM_CALL(XPLMGetDatai(viewTypeDataRef));
+    if (type != viewType)
+    {
+        viewType = type;
+        UpdateCinemaVerite();
+    }
+}
+
+// one-shot flightloop-callback that switches cinema verite back on once the mouse has been idle long enough (it
+// re-arms itself for the rest of the time if the mouse was used again in the meantime)
+static float CinemaVeriteTimerCallback(float, float, int, void *)
+{
+    float remaining = lastMouseUsageTime + disableCinemaVeriteTime - XPLM_CALL(XPLMGetElapsedTime());
+    if (remaining > 0.0f)
+        return remaining;
+
+    mouseInUse = 0;
+    UpdateCinemaVerite();
+
+    return 0.0f;
+}
+
+// notes the time of a mouse event in the fake window (for cinema verite and the input latency)
+static void NoteMouseUsage(void)
+{
+    lastMouseUsageTime = frameState.elapsedTime;
+    if (pendingInputTime == 0.0)
+        pendingInputTime = GetMonotonicTime();
+
+    // switch cinema verite off on the first event and arm the timer that switches it back on
+    if (!mouseInUse && cinemaVeriteTimerFlightLoop != NULL)
+    {
+        mouseInUse = 1;
+        UpdateCinemaVerite();
+        XPLM_CALL(XPLMScheduleFlightLoop(cinemaVeriteTimerFlightLoop, disableCinemaVeriteTime, 1));
+    }
+}
+
+// removes the fragment-shader from video memory, if deleteProgram is set the shader-program is also removed
+static void CleanupShader(int deleteProgram = 0)
+{
+    glDetachShader(program, fragmentShader);
+    glDeleteShader(fragmentShader);
+
+    if (deleteProgram)
         glDeleteProgram(program);
 }
 
-// function to load, compile and link the fragment-shader
-static void InitShader(const char *fragmentShaderString)
+// function to load, compile and link the fragment-shader
+static void InitShader(const char *fragmentShaderString)
+{
+    program = glCreateProgram();
+
+    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fragmentShaderString, 0);
+    glCompileShader(fragmentShader);
+    glAttachShader(program, fragmentShader);
+    GLint isFragmentShaderCompiled = GL_FALSE;
+    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &isFragmentShaderCompiled);
+    if (isFragmentShaderCompiled == GL_FALSE)
+    {
+        GLsizei maxLength = 2048;
+        GLchar *log = new GLchar[maxLength];
+        glGetShaderInfoLog(fragmentShader, maxLength, &maxLength, log);
+        LogWrite(&logQueue, LOG_ERROR, NAME_VERSION": The following error occured while compiling the fragment shader:\n" NAME_VERSION_BLANK);  // indent to align where possible
+        LogWrite(&logQueue, LOG_ERROR, log);
+        delete[] log;
+
+        CleanupShader(1);
+
+        return;
+    }
+
+    glLinkProgram(program);
+    GLint isProgramLinked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &isProgramLinked);
+    if (isProgramLinked == GL_FALSE)
+    {
+        GLsizei maxLength = 2048;
+        GLchar *log = new GLchar[maxLength];
+        glGetShaderInfoLog(fragmentShader, maxLength, &maxLength, log);
+        LogWrite(&logQueue, LOG_ERROR, NAME_VERSION": The following error occured while linking the shader program:\n" NAME_VERSION_BLANK);  // indent to align where possible
+        LogWrite(&logQueue, LOG_ERROR, log);
+        delete[] log;
+
+        CleanupShader(1);
+
+        return;
+    }
+
+    CleanupShader(0);
+}
+
+// get accessor for override_cinema_verite_control DataRef
+int GetOverrideControlCinemaVeriteDataRefCallback(void* inRefcon)
+{
+    return overrideControlCinemaVerite;
+}
+
+// set accessor for override_control_cinema_verite DataRef
+void SetOverrideControlCinemaVeriteDataRefCallback(void* inRefcon, int inValue)
+{
+    int wasOverridden = overrideControlCinemaVerite;
+    overrideControlCinemaVerite = inValue;
+
+    // take over again with the current state (read back, as the datarefs may have been written meanwhile) once the
+    // override ends
+    if (wasOverridden && !overrideControlCinemaVerite)
+        RefreshCinemaVerite();
+}
+
+// returns a float rounded to two decimal places
+static float Round(const float f)
+{
+    return ((int) (f * 100.0f)) / 100.0f;
+}
+
+// sets the raleigh scale dataref to the selected raleigh scale value, passing reset = 1 resets the dataref to its default value
+static void UpdateRaleighScale(int reset)
+{
+    if (!LEGACY_FEATURES)
+        return; // return immediately if XP12.00 or later, since there is no Raleigh anymore
+    
+    if (raleighScaleDataRef != NULL)
+        XPLM_CALL(XPLMSetDataf(raleighScaleDataRef, !reset ? raleighScale : DEFAULT_RALEIGH_SCALE));
+}
+
+// returns the fingerprint of the current grading parameters, to find the active preset
+static uint64_t CurrentFingerprint(void)
+{
+    float params[PARAM_MAX];
+    for (int i = 0; i < PARAM_MAX; i++)
+        params[i] = *BLUfxParams[i].value;
+
+    return Fingerprint(params, raleighScale);
+}
+
+// forgets what the settings widgets show, so that the next UpdateSettingsWidgets refreshes all of them
+static void InvalidateSettingsWidgets(void)
+{
+    for (int i = 0; i < SETTING_ROWS; i++)
+    {
+        shownSettingValues[i] = NAN;
+        shownSliderPositions[i] = INT_MIN;
+        shownCaptions[i][0] = '\0';
+    }
+    for (int i = 0; i < SETTING_CHECKBOXES; i++)
+        shownCheckboxes[i] = -1;
+    shownAdaptiveFpsCaption[0] = '\0';
+    for (int i = 0; i < PRESET_MAX; i++)
+        shownPresetActive[i] = -1;
+    for (int i = 0; i < PRESET_PAGE_SIZE; i++)
+        shownPageActive[i] = -1;
+}
+
+// updates the caption widgets, slider positions and preset buttons whose settings variables changed since the last call
+static void UpdateSettingsWidgets(void)
+{
+    if (settingsWidget == NULL)
+        return;     // not created yet (or the immediate-mode window is used)
+
+    for (int i = 0; i < SETTING_CHECKBOXES; i++)
+    {
+        int value = *BLUfxSettingCheckboxes[i].value;
+        if (value != shownCheckboxes[i])
+        {
+            WIDGET_CALL(XPSetWidgetProperty(*BLUfxSettingCheckboxes[i].checkbox, xpProperty_ButtonState, value));
+            shownCheckboxes[i] = value;
+        }
+    }
+
+    for (int i = 0; i < SETTING_ROWS; i++)
+    {
+        const BLUfxSettingRow_t *row = &BLUfxSettingRows[i];
+        float value = *row->value;
+        if (value == shownSettingValues[i])
+            continue;
+        shownSettingValues[i] = value;
+
+        if (!row->legacyOnly || LEGACY_FEATURES)    // Raleigh is not a thing in XP12, so this is only for pre-XP12
+        {
+            char caption[32];
+            snprintf(caption, 32, row->format, value);
+            if (strcmp(caption, shownCaptions[i]) != 0)
+            {
+                WIDGET_CALL(XPSetWidgetDescriptor(*row->caption, caption));
+                strcpy(shownCaptions[i], caption);
+            }
+        }
+
+        int position = SliderPosition(row, value);
+        if (position != shownSliderPositions[i])
+        {
+            WIDGET_CALL(XPSetWidgetProperty(*row->slider, xpProperty_ScrollBarSliderPosition, (intptr_t) position));
+            shownSliderPositions[i] = position;
+        }
+    }
+
+    char stringAdaptiveFps[32];
+    if (adaptiveFpsEnabled && fpsLimiterEnabled)
+        snprintf(stringAdaptiveFps, 32, "Adaptive: %.0f FPS", adaptiveFps);
+    else
+        snprintf(stringAdaptiveFps, 32, "Adaptive");
+    if (strcmp(stringAdaptiveFps, shownAdaptiveFpsCaption) != 0)
+    {
+        WIDGET_CALL(XPSetWidgetDescriptor(adaptiveFpsCheckbox, stringAdaptiveFps));
+        strcpy(shownAdaptiveFpsCaption, stringAdaptiveFps);
+    }
+
+	// Disable the currently-selected preset, if any, including the "reset" button for the default preset,
+	// and the "restore" or "load .ini" buttons for the current "user" preset:
+	// (Note: we'd prefer to highlight the button, but I can't figure that out.)
+	uint64_t fingerprint = CurrentFingerprint();
+
+	for (int i = PRESET_USER; i <= PRESET_DEFAULT; i++) {
+		int isActive = (presetFingerprints[i] == fingerprint);
+		if (isActive != shownPresetActive[i]) {
+			WIDGET_CALL(XPSetWidgetProperty(presetButtons[i], xpProperty_Enabled, (isActive ? 0 : 1)));	// disable only the ACTIVE preset
+			WIDGET_CALL(XPSetWidgetProperty(presetButtons[i], xpProperty_Hilited, (isActive ? 1 : 0)));	// this seems like it only works in ONE case out of all of them...  TODO
+			shownPresetActive[i] = isActive;
+		}
+	}
+
+	// Same for the catalog buttons on the current page (on-disk presets that haven't been loaded yet can't be active):
+	for (int i = 0; i < PRESET_PAGE_SIZE; i++) {
+		size_t index = presetCatalogPage * PRESET_PAGE_SIZE + i;
+		BLUfxCatalogEntry *entry = (index < presetCatalogView.size() ? &presetCatalog[presetCatalogView[index]] : NULL);
+		int isActive = (entry && entry->loaded && entry->fingerprint == fingerprint);
+		if (isActive != shownPageActive[i]) {
+			WIDGET_CALL(XPSetWidgetProperty(presetPageButtons[i], xpProperty_Enabled, (isActive ? 0 : 1)));
+			WIDGET_CALL(XPSetWidgetProperty(presetPageButtons[i], xpProperty_Hilited, (isActive ? 1 : 0)));
+			shownPageActive[i] = isActive;
+		}
+	}
+}
+
+// starts blending the current grading parameters to the given ones (or applies them right away if transitions are off)
+static void StartTransition(const float *target)
+{
+    if (transitionTime <= 0.0f || parameterFlightLoop == NULL)
+    {
+        for (int i = 0; i < PARAM_MAX; i++)
+            *BLUfxParams[i].value = target[i];
+
+        transitionActive = 0;
+        WakeTask(TASK_SYNC_MASTER);
+        return;
+    }
+
+    for (int i = 0; i < PARAM_MAX; i++)
+    {
+        transitionFrom[i] = *BLUfxParams[i].value;
+        transitionTo[i] = target[i];
+    }
+    transitionElapsed = 0.0f;
+
+    if (!transitionActive)
+    {
+        transitionActive = 1;
+        XPLM_CALL(XPLMScheduleFlightLoop(parameterFlightLoop, -1.0f, 1));
+    }
+}
+
+// queues a validated dataref write of a grading parameter for the next frame, returns false if the value is rejected
+static bool SetPendingParam(int param, float value, int blend)
+{
+    if (param < 0 || param >= PARAM_MAX || value != value || value < -1.0e6f || value > 1.0e6f)
+        return false;   // out of bounds, NaN or infinite
+
+    pendingParams[param] = minMax(BLUfxParams[param].min, value, BLUfxParams[param].max);
+    pendingParamsBlend |= blend;
+
+    if (pendingParamsMask == 0 && !pendingSliderUpdate && !transitionActive && parameterFlightLoop != NULL)
+        XPLM_CALL(XPLMScheduleFlightLoop(parameterFlightLoop, -1.0f, 1));
+    pendingParamsMask |= 1u << param;
+
+    return true;
+}
+
+// returns the value a grading parameter will have in the next frame, including pending dataref writes
+static float GetPendingParam(int param)
+{
+    return (pendingParamsMask & (1u << param) ? pendingParams[param] : *BLUfxParams[param].value);
+}
+
+// refreshes the settings widgets (and writes the raleigh scale) in the next frame, so that the many slider events of a
+// drag cost one refresh per frame
+static void QueueSliderUpdate(void)
+{
+    if (!pendingSliderUpdate && pendingParamsMask == 0 && !transitionActive && parameterFlightLoop != NULL)
+        XPLM_CALL(XPLMScheduleFlightLoop(parameterFlightLoop, -1.0f, 1));
+    pendingSliderUpdate = 1;
+}
+
+// removes a parameter that was just changed directly (e.g., by its slider) from the active transition
+static void PinTransitionParam(int param)
+{
+    if (transitionActive)
+        transitionFrom[param] = transitionTo[param] = *BLUfxParams[param].value;
+}
+
+// applies the dataref writes made since the last frame in one go, writes to the whole vector are blended
+static void ApplyPendingParams(void)
+{
+    if (pendingParamsBlend)
+    {
+        float target[PARAM_MAX];
+        for (int i = 0; i < PARAM_MAX; i++)
+            target[i] = (pendingParamsMask & (1u << i) ? pendingParams[i] : (transitionActive ? transitionTo[i] : *BLUfxParams[i].value));
+
+        StartTransition(target);
+    }
+    else
+    {
+        for (int i = 0; i < PARAM_MAX; i++)
+        {
+            if (pendingParamsMask & (1u << i))
+            {
+                *BLUfxParams[i].value = pendingParams[i];
+                PinTransitionParam(i);
+            }
+        }
+    }
+
+    pendingParamsMask = 0;
+    pendingParamsBlend = 0;
+}
+
+// refreshes the settings widgets after slider events, counting the widget calls against them
+static void UpdateSliderWidgets(void)
+{
+    long widgetCalls = widgetCallCount;
+    if (settingsWidget != NULL)
+        UpdateSettingsWidgets();
+    if (pendingSliderUpdate)
+        sliderEventWidgetCalls += widgetCallCount - widgetCalls;
+    pendingSliderUpdate = 0;
+}
+
+// applies pending dataref writes and slider changes and blends the grading parameters from transitionFrom to
+// transitionTo over transitionTime seconds, the flightloop is only scheduled while there is something to do (see
+// StartTransition, SetPendingParam and QueueSliderUpdate), so there is no per-frame work otherwise
+static float ParameterFlightLoopCallback(float, float inElapsedTimeSinceLastFlightLoop, int, void *)
+{
+    WakeTask(TASK_SYNC_MASTER);     // sends what changes below
+
+    if (pendingParamsMask != 0)
+        ApplyPendingParams();
+    if (pendingRaleighScale)
+    {
+        pendingRaleighScale = 0;
+        UpdateRaleighScale(0);      // note: only happens in for pre-XP12 (otherwise no-op)
+    }
+
+    if (transitionActive)
+    {
+        transitionElapsed += inElapsedTimeSinceLastFlightLoop;
+
+        float t = (transitionTime > 0.0f ? std::min(transitionElapsed / transitionTime, 1.0f) : 1.0f);
+        float s = t * t * (3.0f - 2.0f * t);    // smoothstep, so the transition eases in and out
+
+        for (int i = 0; i < PARAM_MAX; i++)
+            *BLUfxParams[i].value = transitionFrom[i] + (transitionTo[i] - transitionFrom[i]) * s;
+
+        if (t < 1.0f)
+        {
+            // a slider that is dragged during the transition still shows its value right away
+            if (pendingSliderUpdate)
+                UpdateSliderWidgets();
+            return -1.0f;
+        }
+
+        transitionActive = 0;
+    }
+
+    UpdateSliderWidgets();
+
+    return 0.0f;    // done, don't call again until the next transition or dataref write
+}
+
+// get accessor for the datarefs of the individual grading parameters (refcon is the BLUfxParams_t index)
+float GetParamDataRefCallback(void* inRefcon)
+{
+    return GetPendingParam((int) (intptr_t) inRefcon);
+}
+
+// set accessor for the datarefs of the individual grading parameters
+void SetParamDataRefCallback(void* inRefcon, float inValue)
+{
+    SetPendingParam((int) (intptr_t) inRefcon, inValue, 0);
+}
+
+// get accessor for the params float array DataRef (all grading parameters, in BLUfxParams_t order)
+int GetParamsDataRefCallback(void*, float* outValues, int inOffset, int inMax)
+{
+    if (outValues == NULL)
+        return PARAM_MAX;
+    if (inOffset < 0)
+        return 0;
+
+    int count = 0;
+    for (int i = inOffset; i < PARAM_MAX && count < inMax; i++)
+        outValues[count++] = GetPendingParam(i);
+
+    return count;
+}
+
+// set accessor for the params float array DataRef, a write of the whole vector is blended like a preset change
+void SetParamsDataRefCallback(void*, float* inValues, int inOffset, int inCount)
+{
+    for (int i = 0; i < inCount && inOffset + i < PARAM_MAX; i++)
+        SetPendingParam(inOffset + i, inValues[i], 1);
+}
+
+// get accessor for the fps_cap DataRef
+float GetFpsCapDataRefCallback(void*)
+{
+    return GetFpsCap();
+}
+
+// get accessor for the gpu_wait DataRef (smoothed time the low-latency mode waited for the GPU per frame, in ms)
+float GetGpuWaitDataRefCallback(void*)
+{
+    return gpuWaitSmoothed;
+}
+
+// get accessor for the input latency datarefs (refcon is the BLUfxStats_t index of the percentile)
+float GetInputLatencyDataRefCallback(void* inRefcon)
+{
+    return GetFrameStat(&latencyStats, (int) (intptr_t) inRefcon);
+}
+
+// get accessor for the task_times float array DataRef (average run time of each scheduler task in us, in BLUfxTasks_t order)
+int GetTaskTimesDataRefCallback(void*, float* outValues, int inOffset, int inMax)
+{
+    if (outValues == NULL)
+        return TASK_MAX;
+    if (inOffset < 0)
+        return 0;
+
+    int count = 0;
+    for (int i = inOffset; i < TASK_MAX && count < inMax; i++)
+        outValues[count++] = tasks[i].runs > 0 ? (float) (tasks[i].runTimeSum / tasks[i].runs * 1.0e6) : 0.0f;
+
+    return count;
+}
+
+// get accessor for the xplm_calls DataRef (calls into X-Plane made by BLU-fx during the previous frame)
+int GetXplmCallsDataRefCallback(void*)
 {
-    program = glCreateProgram();
+    return frameState.xplmCalls;
+}
 
-    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderString, 0);
-    glCompileShader(fragmentShader);
-    glAttachShader(program, fragmentShader);
-    GLint isFragmentShaderCompiled = GL_FALSE;
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &isFragmentShaderCompiled);
-    if (isFragmentShaderCompiled == GL_FALSE)
+// get accessor for the frame-time statistics datarefs (refcon is the BLUfxStats_t index)
+float GetStatDataRefCallback(void* inRefcon)
+{
+    return GetFrameStat(&frameStats, (int) (intptr_t) inRefcon);
+}
+
+// task that takes the parameters that arrived in the remote control mailbox since the last frame and queues them like
+// dataref writes, which ParameterFlightLoopCallback applies (and which thus also work while post-processing is off)
+static void RemoteMailboxTask(void)
+{
+    float values[REMOTE_MAX_PARAMS];
+    unsigned int mask = TakeRemoteMailbox(&remoteMailbox, values);
+
+    for (int i = 0; i < PARAM_MAX; i++)
     {
-        GLsizei maxLength = 2048;
-        GLchar *log = new GLchar[maxLength];
-        glGetShaderInfoLog(fragmentShader, maxLength, &maxLength, log);
-        XPLMDebugString(NAME_VERSION": The following error occured while compiling the fragment shader:\n");
-        XPLMDebugString(NAME_VERSION_BLANK);  // indent to align where possible
-        XPLMDebugString(log);
-        delete[] log;
+        if (mask & (1u << i))
+            SetPendingParam(i, values[i], 0);
+    }
+}
 
-        CleanupShader(1);
+// opens the remote control port on the loopback interface and starts the receiving thread
+static void StartRemoteControl(void)
+{
+    if (remoteControlRunning.load())
+        return;
+
+#if IBM
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+
+    remoteControlSocket = OpenRemoteControlSocket(remoteControlPort);
 
+    if (remoteControlSocket == INVALID_BLUFX_SOCKET)
+    {
+        LogFormat(&logQueue, LOG_WARNING, NAME_VERSION": Unable to open remote control port 127.0.0.1:%d.\n", remoteControlPort);
+#if IBM
+        WSACleanup();
+#endif
         return;
     }
 
-    glLinkProgram(program);
-    GLint isProgramLinked = GL_FALSE;
-    glGetProgramiv(program, GL_LINK_STATUS, &isProgramLinked);
-    if (isProgramLinked == GL_FALSE)
-    {
-        GLsizei maxLength = 2048;
-        GLchar *log = new GLchar[maxLength];
-        glGetShaderInfoLog(fragmentShader, maxLength, &maxLength, log);
-        XPLMDebugString(NAME_VERSION": The following error occured while linking the shader program:\n");
-        XPLMDebugString(NAME_VERSION_BLANK);  // indent to align where possible
-        XPLMDebugString(log);
-        delete[] log;
+    ResetParamReceiver(&remoteControlReceiver, &remoteMailbox, PARAM_MAX, &logQueue, NAME_VERSION": ");
+    remoteControlRunning.store(true);
+    remoteControlThread = std::thread(ReceiveParamMessages, remoteControlSocket, &remoteControlReceiver, &remoteControlRunning);
 
-        CleanupShader(1);
+    LogFormat(&logQueue, LOG_INFO, NAME_VERSION": Remote control listening on 127.0.0.1:%d.\n", remoteControlPort);
+}
 
+// stops the remote control thread and closes its port
+static void StopRemoteControl(void)
+{
+    if (!remoteControlRunning.load())
         return;
-    }
 
-    CleanupShader(0);
+    remoteControlRunning.store(false);
+    remoteControlThread.join();
+
+    CloseSocket(remoteControlSocket);
+    remoteControlSocket = INVALID_BLUFX_SOCKET;
+#if IBM
+    WSACleanup();
+#endif
 }
 
-// get accessor for override_cinema_verite_control DataRef
-int GetOverrideControlCinemaVeriteDataRefCallback(void* inRefcon)
+// task of the sync master that multicasts changed parameters, or a heartbeat when idle; it runs every
+// SYNC_HEARTBEAT_INTERVAL seconds and is woken in between whenever the parameters may have changed
+static void SyncMasterTask(void)
 {
-    return overrideControlCinemaVerite;
+    float values[PARAM_MAX];
+    for (int i = 0; i < PARAM_MAX; i++)
+        values[i] = *BLUfxParams[i].value;
+
+    double now = GetMonotonicTime();
+    unsigned char buffer[REMOTE_MESSAGE_MAX_SIZE];
+    int length = SyncMasterMessage(&syncMaster, values, (float) (now - syncMasterLastRun), buffer);
+    syncMasterLastRun = now;
+    if (length > 0)
+        SendSyncMessage(syncSocket, syncGroup.c_str(), syncPort, buffer, length);
 }
 
-// set accessor for override_control_cinema_verite DataRef
-void SetOverrideControlCinemaVeriteDataRefCallback(void* inRefcon, int inValue)
+// joins the sync multicast group, either as master (sending) or as follower (receiving on a background thread)
+static void StartSync(void)
 {
-    overrideControlCinemaVerite = inValue;
+    if (syncMode == SYNC_OFF || syncSocket != INVALID_BLUFX_SOCKET)
+        return;
+
+#if IBM
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+
+    syncSocket = OpenSyncSocket(syncGroup.c_str(), syncPort, syncMode == SYNC_MASTER);
+
+    if (syncSocket == INVALID_BLUFX_SOCKET)
+    {
+        LogFormat(&logQueue, LOG_WARNING, NAME_VERSION": Unable to join sync multicast group %s:%d.\n", syncGroup.c_str(), syncPort);
+#if IBM
+        WSACleanup();
+#endif
+        return;
+    }
+
+    if (syncMode == SYNC_MASTER)
+    {
+        float values[PARAM_MAX];
+        for (int i = 0; i < PARAM_MAX; i++)
+            values[i] = *BLUfxParams[i].value;
+        ResetSyncMaster(&syncMaster, values, PARAM_MAX, SyncSequenceSeed());
+        syncMasterLastRun = GetMonotonicTime();
+        SetTaskActive(TASK_SYNC_MASTER, 1);
+    }
+    else
+    {
+        ResetParamReceiver(&syncReceiver, &remoteMailbox, PARAM_MAX, &logQueue, NAME_VERSION": ");
+        syncRunning.store(true);
+        syncThread = std::thread(ReceiveParamMessages, syncSocket, &syncReceiver, &syncRunning);
+    }
+
+    LogFormat(&logQueue, LOG_INFO, NAME_VERSION": Grade sync %s on %s:%d.\n", (syncMode == SYNC_MASTER ? "master sending" : "follower listening"), syncGroup.c_str(), syncPort);
 }
 
-// returns a float rounded to two decimal places
-static float Round(const float f)
+// leaves the sync multicast group
+static void StopSync(void)
 {
-    return ((int) (f * 100.0f)) / 100.0f;
+    if (syncSocket == INVALID_BLUFX_SOCKET)
+        return;
+
+    SetTaskActive(TASK_SYNC_MASTER, 0);
+
+    if (syncRunning.load())
+    {
+        syncRunning.store(false);
+        syncThread.join();
+    }
+
+    CloseSocket(syncSocket);
+    syncSocket = INVALID_BLUFX_SOCKET;
+#if IBM
+    WSACleanup();
+#endif
 }
 
-// sets the raleigh scale dataref to the selected raleigh scale value, passing reset = 1 resets the dataref to its default value
-static void UpdateRaleighScale(int reset)
+#if LIN
+// reads the first line of a small sysfs file, returns false if it can't be read
+static bool ReadSysfsLine(const std::string &path, std::string &line)
 {
-    if (!LEGACY_FEATURES)
-        return; // return immediately if XP12.00 or later, since there is no Raleigh anymore
-    
-    if (raleighScaleDataRef == NULL)
-        raleighScaleDataRef = XPLMFindDataRef("sim/private/controls/atmo/atmo_scale_raleigh");
-    if (raleighScaleDataRef != NULL)
-        XPLMSetDataf(raleighScaleDataRef, !reset ? raleighScale : DEFAULT_RALEIGH_SCALE);
+    std::ifstream file(path.c_str());
+    if (!file.is_open() || !getline(file, line))
+        return false;
+
+    return true;
 }
 
-// updates all caption widgets and slider positions associated with settings variables
-static void UpdateSettingsWidgets(void)
+// returns the names of the entries of a sysfs directory that start with the given prefix
+static std::vector<std::string> ListSysfsDirectory(const std::string &path, const char *prefix)
+{
+    std::vector<std::string> names;
+    DIR *dir = opendir(path.c_str());
+    if (dir == NULL)
+        return names;
+
+    size_t prefixLength = strlen(prefix);
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (entry->d_name[0] != '.' && strncmp(entry->d_name, prefix, prefixLength) == 0)
+            names.push_back(entry->d_name);
+    }
+    closedir(dir);
+
+    return names;
+}
+
+// returns the POWER_* bits of the host from sysfs below the given root: on battery if no mains supply is online and a
+// battery is discharging, hot if a thermal zone has reached the given temperature (until all are a few degrees below it)
+static int ReadHostPowerState(const std::string &root, float hot, int previousState)
 {
-    XPSetWidgetProperty(postProcessingCheckbox, xpProperty_ButtonState, postProcesssingEnabled);
-    XPSetWidgetProperty(fpsLimiterCheckbox, xpProperty_ButtonState, fpsLimiterEnabled);
-    XPSetWidgetProperty(controlCinemaVeriteCheckbox, xpProperty_ButtonState, controlCinemaVeriteEnabled);
+    int state = 0;
+
+    std::string powerSupplyPath = root + "/class/power_supply/";
+    bool mainsOnline = false, discharging = false;
+    std::vector<std::string> supplies = ListSysfsDirectory(powerSupplyPath, "");
+    for (size_t i = 0; i < supplies.size(); i++)
+    {
+        std::string type, value;
+        if (!ReadSysfsLine(powerSupplyPath + supplies[i] + "/type", type))
+            continue;
+
+        if (type == "Mains" && ReadSysfsLine(powerSupplyPath + supplies[i] + "/online", value) && value == "1")
+            mainsOnline = true;
+        else if (type == "Battery" && ReadSysfsLine(powerSupplyPath + supplies[i] + "/status", value) && value == "Discharging")
+            discharging = true;
+    }
+    if (!mainsOnline && discharging)
+        state |= POWER_ON_BATTERY;
+
+    std::string thermalPath = root + "/class/thermal/";
+    float maxTemperature = -1000.0f;
+    std::vector<std::string> zones = ListSysfsDirectory(thermalPath, "thermal_zone");
+    for (size_t i = 0; i < zones.size(); i++)
+    {
+        std::string value;
+        if (ReadSysfsLine(thermalPath + zones[i] + "/temp", value))
+            maxTemperature = std::max(maxTemperature, (float) atol(value.c_str()) / 1000.0f);   // millidegrees C
+    }
+    if (maxTemperature >= hot || ((previousState & POWER_HOT) && maxTemperature > hot - POWER_HOT_HYSTERESIS))
+        state |= POWER_HOT;
 
-    char stringBrightness[32];
-    snprintf(stringBrightness, 32, "Brightness: %.2f", brightness);
-    XPSetWidgetDescriptor(brightnessCaption, stringBrightness);
+    return state;
+}
 
-    char stringContrast[32];
-    snprintf(stringContrast, 32, "Contrast: %.2f", contrast);
-    XPSetWidgetDescriptor(contrastCaption, stringContrast);
+// background thread that polls the host power state every POWER_POLL_INTERVAL ms (no XPLM calls in here!)
+static void MonitorHostPower(std::string root, float hot)
+{
+    int elapsed = POWER_POLL_INTERVAL;
+    while (powerMonitorRunning.load())
+    {
+        if (elapsed >= POWER_POLL_INTERVAL)
+        {
+            int previous = hostPowerState.load(), state = ReadHostPowerState(root, hot, previous);
+            if (state != previous)
+                LogFormat(&logQueue, LOG_INFO, NAME_VERSION": Host power state changed: %s, %s.\n", (state & POWER_ON_BATTERY) ? "on battery" : "on mains", (state & POWER_HOT) ? "hot" : "not hot");
+            hostPowerState.store(state);
+            elapsed = 0;
+        }
 
-    char stringSaturation[32];
-    snprintf(stringSaturation, 32, "Saturation: %.2f", saturation);
-    XPSetWidgetDescriptor(saturationCaption, stringSaturation);
+        // sleep in short steps, so that the thread notices when it is stopped
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        elapsed += 100;
+    }
+}
+#endif
 
-    char stringRedScale[32];
-    snprintf(stringRedScale, 32, "Red Scale: %.2f", redScale);
-    XPSetWidgetDescriptor(redScaleCaption, stringRedScale);
+// starts the power monitor thread if there is an on-battery or hot cap (Linux only)
+static void StartPowerMonitor(void)
+{
+#if LIN
+    if (powerMonitorRunning.load() || (batteryFps <= 0.0f && hotFps <= 0.0f))
+        return;
 
-    char stringGreenScale[32];
-    snprintf(stringGreenScale, 32, "Green Scale: %.2f", greenScale);
-    XPSetWidgetDescriptor(greenScaleCaption, stringGreenScale);
+    LogFormat(&logQueue, LOG_INFO, NAME_VERSION": Monitoring host power state in %s.\n", powerSysfsRoot.c_str());
 
-    char stringBlueScale[32];
-    snprintf(stringBlueScale, 32, "Blue Scale: %.2f", blueScale);
-    XPSetWidgetDescriptor(blueScaleCaption, stringBlueScale);
+    powerMonitorRunning.store(true);
+    powerMonitorThread = std::thread(MonitorHostPower, powerSysfsRoot, hotTemperature);
+#endif
+}
 
-    char stringRedOffset[32];
-    snprintf(stringRedOffset, 32, "Red Offset: %.2f", redOffset);
-    XPSetWidgetDescriptor(redOffsetCaption, stringRedOffset);
+// stops the power monitor thread
+static void StopPowerMonitor(void)
+{
+    if (!powerMonitorRunning.load())
+        return;
 
-    char stringGreenOffset[32];
-    snprintf(stringGreenOffset, 32, "Green Offset: %.2f", greenOffset);
-    XPSetWidgetDescriptor(greenOffsetCaption, stringGreenOffset);
+    powerMonitorRunning.store(false);
+    powerMonitorThread.join();
+    hostPowerState.store(0);
+}
 
-    char stringBlueOffset[32];
-    snprintf(stringBlueOffset, 32, "Blue Offset: %.2f", blueOffset);
-    XPSetWidgetDescriptor(blueOffsetCaption, stringBlueOffset);
+// runs the sim context task (and the power monitor) only while a sim context or the host power state has a cap, also
+// when the caps were changed by loading blu_fx.ini at runtime
+static void UpdateSimContextActive(void)
+{
+    if (schedulerFlightLoop == NULL)
+        return;
 
-    char stringVignette[32];
-    snprintf(stringVignette, 32, "Vignette: %.2f", vignette);
-    XPSetWidgetDescriptor(vignetteCaption, stringVignette);
+    if (batteryFps > 0.0f || hotFps > 0.0f)
+        StartPowerMonitor();
+    else
+        StopPowerMonitor();
 
-    if (LEGACY_FEATURES) {
-        // Raleigh is not a thing in XP12, so this is only for pre-XP12:
-        char stringRaleighScale[32];
-        snprintf(stringRaleighScale, 32, "Raleigh Scale: %.2f", raleighScale);
-        XPSetWidgetDescriptor(raleighScaleCaption, stringRaleighScale);
-    }
-
-    char stringMaxFps[32];
-    snprintf(stringMaxFps, 32, "Max FPS: %.0f", maxFps);
-    XPSetWidgetDescriptor(maxFpsCaption, stringMaxFps);
-
-    char stringDisableCinemaVeriteTime[32];
-    snprintf(stringDisableCinemaVeriteTime, 32, "On input disable for: %.0f sec", disableCinemaVeriteTime);
-    XPSetWidgetDescriptor(disableCinemaVeriteTimeCaption, stringDisableCinemaVeriteTime);
-
-    XPSetWidgetProperty(brightnessSlider, xpProperty_ScrollBarSliderPosition, (intptr_t) ((brightness + 0.5f) * 1000.0f));
-    XPSetWidgetProperty(contrastSlider, xpProperty_ScrollBarSliderPosition, (intptr_t) (contrast * 100.0f));
-    XPSetWidgetProperty(saturationSlider, xpProperty_ScrollBarSliderPosition, (intptr_t) (saturation * 100.0f));
-    XPSetWidgetProperty(redScaleSlider, xpProperty_ScrollBarSliderPosition, (intptr_t) (redScale * 100.0f));
-    XPSetWidgetProperty(greenScaleSlider, xpProperty_ScrollBarSliderPosition, (intptr_t) (greenScale * 100.0f));
-    XPSetWidgetProperty(blueScaleSlider, xpProperty_ScrollBarSliderPosition, (intptr_t) (blueScale * 100.0f));
-    XPSetWidgetProperty(redOffsetSlider, xpProperty_ScrollBarSliderPosition, (intptr_t) (redOffset * 100.0f));
-    XPSetWidgetProperty(greenOffsetSlider, xpProperty_ScrollBarSliderPosition, (intptr_t) (greenOffset * 100.0f));
-    XPSetWidgetProperty(blueOffsetSlider, xpProperty_ScrollBarSliderPosition, (intptr_t) (blueOffset * 100.0f));
-    XPSetWidgetProperty(vignetteSlider, xpProperty_ScrollBarSliderPosition, (intptr_t) (vignette * 100.0f));
-    XPSetWidgetProperty(raleighScaleSlider, xpProperty_ScrollBarSliderPosition, (intptr_t) raleighScale);
-    XPSetWidgetProperty(maxFpsSlider, xpProperty_ScrollBarSliderPosition, (intptr_t) (maxFps));
-    XPSetWidgetProperty(disableCinemaVeriteTimeSlider, xpProperty_ScrollBarSliderPosition, (intptr_t) (disableCinemaVeriteTime));
-	
-	// Disable the currently-selected preset, if any, including the "reset" button for the default preset,
-	// and the "restore" or "load .ini" buttons for the current "user" preset:
-	// (Note: we'd prefer to highlight the button, but I can't figure that out.)
-	int i;
-	for (int i = 0; i < PRESET_MAX; i++) {
-		bool isActive = isActivePreset(&BLUfxPresets[i]);
-		XPSetWidgetProperty(presetButtons[i], xpProperty_Enabled, (isActive ? 0 : 1));	// disable only the ACTIVE preset
-		XPSetWidgetProperty(presetButtons[i], xpProperty_Hilited, (isActive ? 1 : 0));	// this seems like it only works in ONE case out of all of them...  TODO
-	}
+    int active = pausedFps > 0.0f || replayFps > 0.0f || powerMonitorRunning.load();
+    SetTaskActive(TASK_SIM_CONTEXT, active);
+    if (!active)
+    {
+        simContext = SIM_CONTEXT_FLYING;
+        powerState = 0;
+    }
+
+    UpdateLimiterActive();
 }
 
 // saves current settings to the config file
@@ -975,6 +3273,25 @@ static void SaveSettings(void)
         file << "raleighScale=" << raleighScale << std::endl;
         file << "maxFps=" << maxFps << std::endl;
         file << "disableCinemaVeriteTime=" << disableCinemaVeriteTime << std::endl;
+        file << "transitionTime=" << transitionTime << std::endl;
+        file << "remoteControlEnabled=" << remoteControlEnabled << std::endl;
+        file << "remoteControlPort=" << remoteControlPort << std::endl;
+        file << "syncMode=" << syncMode << std::endl;
+        file << "syncGroup=" << syncGroup << std::endl;
+        file << "syncPort=" << syncPort << std::endl;
+        file << "adaptiveFpsEnabled=" << adaptiveFpsEnabled << std::endl;
+        file << "refreshRate=" << refreshRate << std::endl;
+        file << "pausedFps=" << pausedFps << std::endl;
+        file << "replayFps=" << replayFps << std::endl;
+        file << "batteryFps=" << batteryFps << std::endl;
+        file << "hotFps=" << hotFps << std::endl;
+        file << "hotTemperature=" << hotTemperature << std::endl;
+        file << "powerSysfsRoot=" << powerSysfsRoot << std::endl;
+        file << "lowLatencyFrames=" << lowLatencyFrames << std::endl;
+        file << "modernSettingsWindow=" << modernSettingsWindow << std::endl;
+        file << "presetThumbnails=" << presetThumbnailsEnabled << std::endl;
+        file << "compareMode=" << compareMode << std::endl;
+        file << "logLevel=" << logLevel << std::endl;
 
         file.close();
     }
@@ -1027,9 +3344,53 @@ static void LoadSettings(void)
                 iss >> maxFps;
             else if(line.find("disableCinemaVeriteTime") != std::string::npos)
                 iss >> disableCinemaVeriteTime;
+            else if(line.find("transitionTime") != std::string::npos)
+                iss >> transitionTime;
+            else if(line.find("remoteControlEnabled") != std::string::npos)
+                iss >> remoteControlEnabled;
+            else if(line.find("remoteControlPort") != std::string::npos)
+                iss >> remoteControlPort;
+            else if(line.find("syncMode") != std::string::npos)
+                iss >> syncMode;
+            else if(line.find("syncGroup") != std::string::npos)
+                iss >> syncGroup;
+            else if(line.find("syncPort") != std::string::npos)
+                iss >> syncPort;
+            else if(line.find("adaptiveFpsEnabled") != std::string::npos)
+                iss >> adaptiveFpsEnabled;
+            else if(line.find("refreshRate") != std::string::npos)
+                iss >> refreshRate;
+            else if(line.find("pausedFps") != std::string::npos)
+                iss >> pausedFps;
+            else if(line.find("replayFps") != std::string::npos)
+                iss >> replayFps;
+            else if(line.find("batteryFps") != std::string::npos)
+                iss >> batteryFps;
+            else if(line.find("hotFps") != std::string::npos)
+                iss >> hotFps;
+            else if(line.find("hotTemperature") != std::string::npos)
+                iss >> hotTemperature;
+            else if(line.find("powerSysfsRoot") != std::string::npos)
+                powerSysfsRoot = val;
+            else if(line.find("lowLatencyFrames") != std::string::npos)
+                iss >> lowLatencyFrames;
+            else if(line.find("modernSettingsWindow") != std::string::npos)
+                iss >> modernSettingsWindow;
+            else if(line.find("presetThumbnails") != std::string::npos)
+                iss >> presetThumbnailsEnabled;
+            else if(line.find("compareMode") != std::string::npos)
+                iss >> compareMode;
+            else if(line.find("logLevel") != std::string::npos)
+                iss >> logLevel;
         }
 
         file.close();
+
+        logQueue.level.store(minMax((int) LOG_DEBUG, logLevel, (int) LOG_ERROR), std::memory_order_relaxed);
+        UpdateSimContextActive();
+
+        // a refresh rate of 0 (or less) would leave the adaptive FPS-Limiter without a cap
+        refreshRate = (refreshRate > 0.0f ? minMax(MIN_REFRESH_RATE, refreshRate, MAX_REFRESH_RATE) : DEFAULT_REFRESH_RATE);
         
         // saves the initial configuration throughout the session
         static bool sIsFirstLoad = true;
@@ -1049,100 +3410,350 @@ static void LoadSettings(void)
             BLUfxPresets[PRESET_USER].raleighScale = raleighScale;
             BLUfxPresets[PRESET_USER].maxFps = maxFps;
             BLUfxPresets[PRESET_USER].disableCinemaVeriteTime = disableCinemaVeriteTime;
+            UpdatePresetFingerprint(PRESET_USER);
         }
     }
+
+    // a sync master sends the values just loaded right away
+    WakeTask(TASK_SYNC_MASTER);
 }
 
-// handles the settings widget
-static int SettingsWidgetHandler(XPWidgetMessage inMessage, XPWidgetID inWidget, long inParam1, long inParam2)
+// reads a single "key=value" line of a preset file into the given preset, returns false if the key is unknown
+static bool ParsePresetLine(const std::string &line, BLUfxPreset *preset)
 {
-    if (inMessage == xpMessage_CloseButtonPushed)
+    size_t separator = line.find("=");
+    if (separator == std::string::npos)
+        return false;
+
+    std::string key = line.substr(0, separator);
+    std::istringstream iss(line.substr(separator + 1));
+
+    if (key == "brightness")
+        iss >> preset->brightness;
+    else if (key == "contrast")
+        iss >> preset->contrast;
+    else if (key == "saturation")
+        iss >> preset->saturation;
+    else if (key == "redScale")
+        iss >> preset->redScale;
+    else if (key == "greenScale")
+        iss >> preset->greenScale;
+    else if (key == "blueScale")
+        iss >> preset->blueScale;
+    else if (key == "redOffset")
+        iss >> preset->redOffset;
+    else if (key == "greenOffset")
+        iss >> preset->greenOffset;
+    else if (key == "blueOffset")
+        iss >> preset->blueOffset;
+    else if (key == "vignette")
+        iss >> preset->vignette;
+    else if (key == "raleighScale")
+        iss >> preset->raleighScale;
+    else if (key == "maxFps")
+        iss >> preset->maxFps;
+    else if (key == "disableCinemaVeriteTime")
+        iss >> preset->disableCinemaVeriteTime;
+    else
+        return false;
+
+    return true;
+}
+
+// reads only the metadata header ("name=", "author=") of a preset file, which must precede the values
+static void IndexPresetFile(const std::string &path, const std::string &fileName)
+{
+    std::ifstream file;
+    file.open(path.c_str());
+
+    if(file.is_open())
     {
-        if (XPIsWidgetVisible(settingsWidget))
+        BLUfxCatalogEntry entry;
+        entry.name = fileName.substr(0, fileName.size() - strlen(PRESET_FILE_EXTENSION));
+        entry.path = path;
+        entry.loaded = false;
+        entry.fingerprint = 0;
+        entry.preset = BLUfxPresets[PRESET_DEFAULT];
+
+        std::string line;
+
+        while(getline(file, line))
         {
-            //SaveSettings();   // now explicit save button and save in XPluginStop()
-            XPHideWidget(settingsWidget);
+            if (!line.empty() && line[line.size() - 1] == '\r')
+                line.erase(line.size() - 1);    // tolerate presets edited on Windows
+
+            if (line.empty() || line[0] == '#' || line[0] == ';')
+                continue;
+            else if (line.compare(0, 5, "name=") == 0)
+                entry.name = line.substr(5);
+            else if (line.compare(0, 7, "author=") == 0)
+                entry.author = line.substr(7);
+            else
+                break;      // end of header, don't read the values until the preset is selected
         }
+
+        file.close();
+
+        if (!entry.name.empty())
+            presetCatalog.push_back(entry);
     }
-    else if (inMessage == xpMsg_ButtonStateChanged)
+}
+
+// loads the values of an on-disk preset when it is first selected, returns NULL if the file can't be read anymore
+static BLUfxPreset *LoadCatalogPreset(BLUfxCatalogEntry *entry)
+{
+    if (!entry->loaded)
     {
-        if (inParam1 == (long) postProcessingCheckbox)
-        {
-            postProcesssingEnabled = (int) XPGetWidgetProperty(postProcessingCheckbox, xpProperty_ButtonState, 0);
+        std::ifstream file;
+        file.open(entry->path.c_str());
 
-            if (!postProcesssingEnabled)
-            {
-                XPLMUnregisterDrawCallback(PostProcessingCallback, xplm_Phase_Window, 1, NULL);
-                UpdateRaleighScale(1);      // note: only happens in for pre-XP12 (otherwise no-op)
-            }
-            else
-            {
-                XPLMRegisterDrawCallback(PostProcessingCallback, xplm_Phase_Window, 1, NULL);
-                UpdateRaleighScale(0);      // note: only happens in for pre-XP12 (otherwise no-op)
-            }
+        if(!file.is_open())
+        {
+            LogFormat(&logQueue, LOG_WARNING, NAME_VERSION": Unable to read preset file: %s\n", entry->path.c_str());
 
+            return NULL;
         }
-        else if (inParam1 == (long) fpsLimiterCheckbox)
+
+        std::string line;
+
+        while(getline(file, line))
+            ParsePresetLine(line, &entry->preset);
+
+        file.close();
+
+        // hand-edited files may hold anything, keep the values within the ranges of the sliders (the rows of
+        // BLUfxSettingRows are in the order of the fields of BLUfxPreset_t)
+        float *values = &entry->preset.brightness;
+        for (int i = 0; i <= SETTING_ROW_DISABLE_CINEMA_VERITE_TIME; i++)
+            values[i] = ClampToSettingRow(&BLUfxSettingRows[i], values[i]);
+        entry->loaded = true;
+        entry->fingerprint = PresetFingerprint(&entry->preset);
+    }
+
+    return &entry->preset;
+}
+
+// builds the preset catalog from the built-in presets and the index of all preset files in PRESETS_PATH
+static void ScanPresetLibrary(void)
+{
+    presetCatalog.clear();
+
+    // built-in presets come first, in their usual order (restore and reset have their own buttons)
+    for (int i = PRESET_POLAROID; i < PRESET_MAX; i++)
+    {
+        BLUfxCatalogEntry entry;
+        entry.name = BLUfxPresetNames[i];
+        entry.loaded = true;
+        entry.preset = BLUfxPresets[i];
+        entry.fingerprint = PresetFingerprint(&entry.preset);
+        presetCatalog.push_back(entry);
+    }
+    size_t builtInCount = presetCatalog.size();
+
+    char systemPath[512];
+    XPLMGetSystemPath(systemPath);
+    std::string directory = std::string(systemPath) + PRESETS_PATH;
+
+    char fileNames[8192];
+    char *indices[256];
+    int firstReturn = 0, totalFiles = 0, returnedFiles = 0;
+
+    do
+    {
+        returnedFiles = 0;
+        XPLMGetDirectoryContents(directory.c_str(), firstReturn, fileNames, sizeof(fileNames), indices, 256, &totalFiles, &returnedFiles);
+
+        for (int i = 0; i < returnedFiles && indices[i] != NULL; i++)
         {
-            fpsLimiterEnabled = (int) XPGetWidgetProperty(fpsLimiterCheckbox, xpProperty_ButtonState, 0);
+            std::string fileName = indices[i];
+            size_t extensionLength = strlen(PRESET_FILE_EXTENSION);
 
-            if (!fpsLimiterEnabled)
-            {
-                XPLMUnregisterFlightLoopCallback(LimiterFlightCallback, NULL);
-                XPLMUnregisterDrawCallback(LimiterDrawCallback, xplm_Phase_Terrain, 1, NULL);
-            }
-            else
-            {
-                XPLMRegisterFlightLoopCallback(LimiterFlightCallback, -1, NULL);
-                XPLMRegisterDrawCallback(LimiterDrawCallback, xplm_Phase_Terrain, 1, NULL);
-            }
+            if (fileName.size() > extensionLength && fileName.compare(fileName.size() - extensionLength, extensionLength, PRESET_FILE_EXTENSION) == 0)
+                IndexPresetFile(directory + XPLMGetDirectorySeparator() + fileName, fileName);
+        }
+
+        firstReturn += returnedFiles;
+    }
+    while (returnedFiles > 0 && firstReturn < totalFiles);
+
+    // on-disk presets are listed alphabetically after the built-in ones
+    std::sort(presetCatalog.begin() + builtInCount, presetCatalog.end(), [](const BLUfxCatalogEntry &a, const BLUfxCatalogEntry &b) { return a.name < b.name; });
+
+    LogFormat(&logQueue, LOG_INFO, NAME_VERSION": Indexed %d presets (%d from the preset library).\n", (int) presetCatalog.size(), (int) (presetCatalog.size() - builtInCount));
+}
+
+// rebuilds the list of catalog entries whose name or author contains the search text (case-insensitive)
+static void FilterPresetCatalog(const char *searchText)
+{
+    std::string search(searchText);
+    std::transform(search.begin(), search.end(), search.begin(), ::tolower);
+
+    presetCatalogView.clear();
+    for (size_t i = 0; i < presetCatalog.size(); i++)
+    {
+        std::string haystack = presetCatalog[i].name + " " + presetCatalog[i].author;
+        std::transform(haystack.begin(), haystack.end(), haystack.begin(), ::tolower);
+
+        if (search.empty() || haystack.find(search) != std::string::npos)
+            presetCatalogView.push_back((int) i);
+    }
+
+    presetCatalogPage = 0;
+}
 
+// updates the captions and visibility of the preset catalog buttons for the current page
+static void UpdatePresetCatalogWidgets(void)
+{
+    int pageCount = std::max(1, (int) (presetCatalogView.size() + PRESET_PAGE_SIZE - 1) / PRESET_PAGE_SIZE);
+    presetCatalogPage = minMax(0, presetCatalogPage, pageCount - 1);
+
+    for (int i = 0; i < PRESET_PAGE_SIZE; i++)
+    {
+        size_t index = presetCatalogPage * PRESET_PAGE_SIZE + i;
+
+        if (index < presetCatalogView.size())
+        {
+            XPSetWidgetDescriptor(presetPageButtons[i], presetCatalog[presetCatalogView[index]].name.c_str());
+            XPShowWidget(presetPageButtons[i]);
         }
-        else if (inParam1 == (long) controlCinemaVeriteCheckbox)
+        else
+            XPHideWidget(presetPageButtons[i]);
+    }
+
+    char stringPage[48];
+    snprintf(stringPage, 48, "Page %d / %d (%d presets)", presetCatalogPage + 1, pageCount, (int) presetCatalogView.size());
+    XPSetWidgetDescriptor(presetPageCaption, stringPage);
+
+    // the page buttons now stand for other presets
+    for (int i = 0; i < PRESET_PAGE_SIZE; i++)
+        shownPageActive[i] = -1;
+
+    XPSetWidgetProperty(presetPreviousPageButton, xpProperty_Enabled, presetCatalogPage > 0);
+    XPSetWidgetProperty(presetNextPageButton, xpProperty_Enabled, presetCatalogPage < pageCount - 1);
+}
+
+// blends the settings globals to the values of a preset (see StartTransition)
+static void ApplyPreset(const BLUfxPreset *preset)
+{
+    StartTransition(PresetParams(preset));
+#ifdef INCLUDE_SETTINGS_IN_PRESETS  /* not really loaded, except for reload .ini */
+    raleighScale = preset->raleighScale;
+    maxFps = preset->maxFps;
+    disableCinemaVeriteTime = preset->disableCinemaVeriteTime;
+#endif
+}
+
+// switches the post-processing pass on or off (checkbox of either settings window)
+static void SetPostProcessingEnabled(int enabled)
+{
+    postProcesssingEnabled = enabled;
+
+    if (!postProcesssingEnabled)
+    {
+        XPLMUnregisterDrawCallback(PostProcessingCallback, xplm_Phase_Window, 1, NULL);
+        ReleaseFrameFences();
+        UpdateRaleighScale(1);      // note: only happens in for pre-XP12 (otherwise no-op)
+    }
+    else
+    {
+        XPLMRegisterDrawCallback(PostProcessingCallback, xplm_Phase_Window, 1, NULL);
+        UpdateRaleighScale(0);      // note: only happens in for pre-XP12 (otherwise no-op)
+    }
+}
+
+// switches the FPS-Limiter on or off
+static void SetFpsLimiterEnabled(int enabled)
+{
+    fpsLimiterEnabled = enabled;
+
+    UpdateLimiterActive();
+    UpdateSettingsWidgets();
+}
+
+// switches the adaptive cap of the FPS-Limiter on or off
+static void SetAdaptiveFpsEnabled(int enabled)
+{
+    adaptiveFpsEnabled = enabled;
+
+    ResetAdaptiveFps();
+    UpdateSettingsWidgets();
+}
+
+// switches the cinema verite control on or off
+static void SetControlCinemaVeriteEnabled(int enabled)
+{
+    controlCinemaVeriteEnabled = enabled;
+
+    SetTaskActive(TASK_CONTROL_CINEMA_VERITE, NeedsCinemaVeriteTask());
+    if (controlCinemaVeriteEnabled)
+        RefreshCinemaVerite();
+}
+
+// handles the settings widget
+static int SettingsWidgetHandler(XPWidgetMessage inMessage, XPWidgetID inWidget, long inParam1, long inParam2)
+{
+    if (inMessage == xpMsg_Reshape)
+    {
+        if (inParam1 == (long) settingsWidget)
+            settingsWidgetMoved = 1;
+    }
+    else if (inMessage == xpMessage_CloseButtonPushed)
+    {
+        if (XPIsWidgetVisible(settingsWidget))
         {
-            controlCinemaVeriteEnabled = (int) XPGetWidgetProperty(controlCinemaVeriteCheckbox, xpProperty_ButtonState, 0);
-
-            if (!controlCinemaVeriteEnabled)
-                XPLMUnregisterFlightLoopCallback(ControlCinemaVeriteCallback, NULL);
-            else
-                XPLMRegisterFlightLoopCallback(ControlCinemaVeriteCallback, -1, NULL);
-
+            //SaveSettings();   // now explicit save button and save in XPluginStop()
+            XPHideWidget(settingsWidget);
         }
     }
+    else if (inMessage == xpMsg_ButtonStateChanged)
+    {
+        if (inParam1 == (long) postProcessingCheckbox)
+            SetPostProcessingEnabled((int) XPGetWidgetProperty(postProcessingCheckbox, xpProperty_ButtonState, 0));
+        else if (inParam1 == (long) fpsLimiterCheckbox)
+            SetFpsLimiterEnabled((int) XPGetWidgetProperty(fpsLimiterCheckbox, xpProperty_ButtonState, 0));
+        else if (inParam1 == (long) adaptiveFpsCheckbox)
+            SetAdaptiveFpsEnabled((int) XPGetWidgetProperty(adaptiveFpsCheckbox, xpProperty_ButtonState, 0));
+        else if (inParam1 == (long) controlCinemaVeriteCheckbox)
+            SetControlCinemaVeriteEnabled((int) XPGetWidgetProperty(controlCinemaVeriteCheckbox, xpProperty_ButtonState, 0));
+    }
     else if (inMessage == xpMsg_ScrollBarSliderPositionChanged)
     {
-#define minMax(a,b,c) (std::min((std::max((a), (b))),(c)))
+        // the grading parameters go through the same per-frame queue as dataref writes (a slider that is moved
+        // during a transition takes precedence over it), so a drag is applied at most once per frame
         if (inParam1 == (long) brightnessSlider)
-            brightness = minMax(-0.5f, Round(XPGetWidgetProperty(brightnessSlider, xpProperty_ScrollBarSliderPosition, 0) / 1000.0f) - 0.5f, 0.5f);
+            SetPendingParam(PARAM_BRIGHTNESS, Round(XPGetWidgetProperty(brightnessSlider, xpProperty_ScrollBarSliderPosition, 0) / 1000.0f) - 0.5f, 0);
         else if (inParam1 == (long) contrastSlider)
-            contrast = Round(XPGetWidgetProperty(contrastSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f);
+            SetPendingParam(PARAM_CONTRAST, Round(XPGetWidgetProperty(contrastSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f), 0);
         else if (inParam1 == (long) saturationSlider)
-            saturation = Round(XPGetWidgetProperty(saturationSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f);
+            SetPendingParam(PARAM_SATURATION, Round(XPGetWidgetProperty(saturationSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f), 0);
         else if (inParam1 == (long) redScaleSlider)
-            redScale = Round(XPGetWidgetProperty(redScaleSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f);
+            SetPendingParam(PARAM_RED_SCALE, Round(XPGetWidgetProperty(redScaleSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f), 0);
         else if (inParam1 == (long) greenScaleSlider)
-            greenScale = Round(XPGetWidgetProperty(greenScaleSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f);
+            SetPendingParam(PARAM_GREEN_SCALE, Round(XPGetWidgetProperty(greenScaleSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f), 0);
         else if (inParam1 == (long) blueScaleSlider)
-            blueScale = Round(XPGetWidgetProperty(blueScaleSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f);
+            SetPendingParam(PARAM_BLUE_SCALE, Round(XPGetWidgetProperty(blueScaleSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f), 0);
         else if (inParam1 == (long) redOffsetSlider)
-            redOffset = Round(XPGetWidgetProperty(redOffsetSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f);
+            SetPendingParam(PARAM_RED_OFFSET, Round(XPGetWidgetProperty(redOffsetSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f), 0);
         else if (inParam1 == (long) greenOffsetSlider)
-            greenOffset = Round(XPGetWidgetProperty(greenOffsetSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f);
+            SetPendingParam(PARAM_GREEN_OFFSET, Round(XPGetWidgetProperty(greenOffsetSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f), 0);
         else if (inParam1 == (long) blueOffsetSlider)
-            blueOffset = Round(XPGetWidgetProperty(blueOffsetSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f);
+            SetPendingParam(PARAM_BLUE_OFFSET, Round(XPGetWidgetProperty(blueOffsetSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f), 0);
         else if (inParam1 == (long) vignetteSlider)
-            vignette = Round(XPGetWidgetProperty(vignetteSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f);
+            SetPendingParam(PARAM_VIGNETTE, Round(XPGetWidgetProperty(vignetteSlider, xpProperty_ScrollBarSliderPosition, 0) / 100.0f), 0);
         else if (inParam1 == (long) raleighScaleSlider)
         {
             raleighScale = Round((float) XPGetWidgetProperty(raleighScaleSlider, xpProperty_ScrollBarSliderPosition, 0));
-            UpdateRaleighScale(0);      // note: only happens in for pre-XP12 (otherwise no-op)
+            pendingRaleighScale = 1;    // the dataref is written once per frame
         }
         else if (inParam1 == (long) maxFpsSlider)
             maxFps = (float) (int) XPGetWidgetProperty(maxFpsSlider, xpProperty_ScrollBarSliderPosition, 0);
         else if (inParam1 == (long) disableCinemaVeriteTimeSlider)
             disableCinemaVeriteTime = (float) (int) XPGetWidgetProperty(disableCinemaVeriteTimeSlider, xpProperty_ScrollBarSliderPosition, 0);
+        else if (inParam1 == (long) transitionTimeSlider)
+            transitionTime = XPGetWidgetProperty(transitionTimeSlider, xpProperty_ScrollBarSliderPosition, 0) / 10.0f;
 
-        UpdateSettingsWidgets();
+        QueueSliderUpdate();
+        sliderEvents++;
     }
     else if (inMessage == xpMsg_PushButtonPressed)
     {
@@ -1154,33 +3765,41 @@ static int SettingsWidgetHandler(XPWidgetMessage inMessage, XPWidgetID inWidget,
         else if (inParam1 == (long) loadButton)
         {
             LoadSettings();
+
+            // the values just loaded take precedence over a running transition
+            for (int i = 0; i < PARAM_MAX; i++)
+                PinTransitionParam(i);
         }
         else if (inParam1 == (long) saveButton)
         {
             SaveSettings();
         }
+        else if (inParam1 == (long) presetPreviousPageButton)
+        {
+            presetCatalogPage--;
+            UpdatePresetCatalogWidgets();
+        }
+        else if (inParam1 == (long) presetNextPageButton)
+        {
+            presetCatalogPage++;
+            UpdatePresetCatalogWidgets();
+        }
+        else if (inParam1 == (long) presetButtons[PRESET_USER])
+            ApplyPreset(&BLUfxPresets[PRESET_USER]);
+        else if (inParam1 == (long) presetButtons[PRESET_DEFAULT])
+            ApplyPreset(&BLUfxPresets[PRESET_DEFAULT]);
         else
         {
             int i;
-            for (i=0; i < PRESET_MAX; i++)
+            for (i=0; i < PRESET_PAGE_SIZE; i++)
             {
-                if ((long) presetButtons[i] == (long) inParam1)
+                size_t index = presetCatalogPage * PRESET_PAGE_SIZE + i;
+
+                if ((long) presetPageButtons[i] == (long) inParam1 && index < presetCatalogView.size())
                 {
-                    brightness = BLUfxPresets[i].brightness;
-                    contrast = BLUfxPresets[i].contrast;
-                    saturation = BLUfxPresets[i].saturation;
-                    redScale = BLUfxPresets[i].redScale;
-                    greenScale = BLUfxPresets[i].greenScale;
-                    blueScale = BLUfxPresets[i].blueScale;
-                    redOffset = BLUfxPresets[i].redOffset;
-                    greenOffset = BLUfxPresets[i].greenOffset;
-                    blueOffset = BLUfxPresets[i].blueOffset;
-                    vignette = BLUfxPresets[i].vignette;
-#ifdef INCLUDE_SETTINGS_IN_PRESETS  /* not really loaded, except for reload .ini */
-                    raleighScale = BLUfxPresets[i].raleighScale;
-                    maxFps = BLUfxPresets[i].maxFps;
-                    disableCinemaVeriteTime = BLUfxPresets[i].disableCinemaVeriteTime;
-#endif
+                    BLUfxPreset *preset = LoadCatalogPreset(&presetCatalog[presetCatalogView[index]]);
+                    if (preset != NULL)
+                        ApplyPreset(preset);
 
                     break;
                 }
@@ -1189,6 +3808,17 @@ static int SettingsWidgetHandler(XPWidgetMessage inMessage, XPWidgetID inWidget,
 
         UpdateSettingsWidgets();
     }
+    else if (inMessage == xpMsg_TextFieldChanged)
+    {
+        if (inParam1 == (long) presetSearchField)
+        {
+            char searchText[64];
+            XPGetWidgetDescriptor(presetSearchField, searchText, sizeof(searchText));
+            FilterPresetCatalog(searchText);
+            UpdatePresetCatalogWidgets();
+            UpdateSettingsWidgets();
+        }
+    }
 
     return 0;
 }
@@ -1197,16 +3827,18 @@ static int SettingsWidgetHandler(XPWidgetMessage inMessage, XPWidgetID inWidget,
 void MenuHandlerCallback(void *inMenuRef, void *inItemRef)
 {
     // settings menu entry
-    if ((long) inItemRef == 0)
+    if ((long) inItemRef == 0 && modernSettingsWindow)
+        ShowSettingsWindow(1);
+    else if ((long) inItemRef == 0)
     {
         if (settingsWidget == NULL)
         {
             // create settings widget
-            int x = 10, y = 0, w = 370, h = 783;
+            int x = 10, y = 0, w = 370, h = 828;
             
             // get screen bounds:
             int screenLeft = 0, screenTop = 0, screenRight = 0, screenBottom = 0;
-            XPLMGetScreenBoundsGlobal(&screenLeft, &screenTop, &screenRight, &screenBottom);
+            XPLM_CALL(XPLMGetScreenBoundsGlobal(&screenLeft, &screenTop, &screenRight, &screenBottom));
             int screenWidth = (screenRight - screenLeft);
             int screenHeight = (screenTop - screenBottom);
 
@@ -1417,106 +4049,50 @@ void MenuHandlerCallback(void *inMenuRef, void *inItemRef)
             // add post-processing presets caption
             XPCreateWidget(x + 10, y - 330, x2 - 20, y - 345, 1, "Post-Processing Presets:", 0, settingsWidget, xpWidgetClass_Caption);
 
+            // add preset search field (filters the catalog by name or author)
+            presetSearchField = XPCreateWidget(x2 - 20 - 110, y - 330, x2 - 20, y - 345, 1, "", 0, settingsWidget, xpWidgetClass_TextField);
+            XPSetWidgetProperty(presetSearchField, xpProperty_TextFieldType, xpTextEntryField);
+            XPSetWidgetProperty(presetSearchField, xpProperty_MaxCharacters, 63);
+
             y += 10; // start button group closer to title to save vertical space
             
-            // first preset button column
-            
             int top = y;
-            
-            // add polaroid preset button
-            presetButtons[PRESET_POLAROID] = XPCreateWidget(x + 20, y - 360, x + 20 + 125, y - 375, 1, "Polaroid", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_POLAROID], xpProperty_ButtonType, xpPushButton);
-            y += 2;
-            
-            // add fogged up preset button
-            presetButtons[PRESET_FOGGED_UP] = XPCreateWidget(x + 20, y - 385, x + 20 + 125, y - 400, 1, "Fogged Up", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_FOGGED_UP], xpProperty_ButtonType, xpPushButton);
-            y += 2;
-            
-            // add high dynamic range preset button
-            presetButtons[PRESET_HIGH_DYNAMIC_RANGE] = XPCreateWidget(x + 20, y - 410, x + 20 + 125, y - 425, 1, "High Dynamic Range", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_HIGH_DYNAMIC_RANGE], xpProperty_ButtonType, xpPushButton);
-            y += 2;
-
-            // add editor's choice drab preset button
-            presetButtons[PRESET_EDITORS_CHOICE] = XPCreateWidget(x + 20, y - 435, x + 20 + 125, y - 450, 1, "Editor's Choice", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_EDITORS_CHOICE], xpProperty_ButtonType, xpPushButton);
-            y += 2;
-
-            // add slightly enhanced preset button
-            presetButtons[PRESET_SLIGHTLY_ENHANCED] = XPCreateWidget(x + 20, y - 460, x + 20 + 125, y - 475, 1, "Slightly Enhanced", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_SLIGHTLY_ENHANCED], xpProperty_ButtonType, xpPushButton);
-            y += 2;
-
-            // add extra gloomy preset button
-            presetButtons[PRESET_EXTRA_GLOOMY] = XPCreateWidget(x + 20, y - 485, x + 20 + 125, y - 500, 1, "Extra Gloomy", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_EXTRA_GLOOMY], xpProperty_ButtonType, xpPushButton);
-            y += 2;
-
-            // add red shift preset button
-            presetButtons[PRESET_RED_ISH] = XPCreateWidget(x + 20, y - 510, x + 20 + 125, y - 525, 1, "Red-ish", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_RED_ISH], xpProperty_ButtonType, xpPushButton);
-            y += 2;
-
-            // add green shift preset button
-            presetButtons[PRESET_GREEN_ISH] = XPCreateWidget(x + 20, y - 535, x + 20 + 125, y - 550, 1, "Green-ish", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_GREEN_ISH], xpProperty_ButtonType, xpPushButton);
-            y += 2;
-
-            // add blue shift preset button
-            presetButtons[PRESET_BLUE_ISH] = XPCreateWidget(x + 20, y - 560, x + 20 + 125, y - 575, 1, "Blue-ish", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_BLUE_ISH], xpProperty_ButtonType, xpPushButton);
-            
-            // second preset button column
-            
-            y = top;
-            
-            // add shiny california preset button
-            presetButtons[PRESET_SHINY_CALIFORNIA] = XPCreateWidget(x2 - 20 - 125, y - 360, x2 - 20, y - 375, 1, "Shiny California", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_SHINY_CALIFORNIA], xpProperty_ButtonType, xpPushButton);
-            y += 2;
-
-            // add dusty dry preset button
-            presetButtons[PRESET_DUSTY_DRY] = XPCreateWidget(x2 - 20 - 125, y - 385, x2 - 20, y - 400, 1, "Dusty Dry", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_DUSTY_DRY], xpProperty_ButtonType, xpPushButton);
-            y += 2;
-
-            // add gray winter preset button
-            presetButtons[PRESET_GRAY_WINTER] = XPCreateWidget(x2 - 20 - 125, y - 410, x2 - 20, y - 425, 1, "Gray Winter", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_GRAY_WINTER], xpProperty_ButtonType, xpPushButton);
-            y += 2;
-
-            // add fancy imagination dreams preset button
-            presetButtons[PRESET_FANCY_IMAGINATION] = XPCreateWidget(x2 - 20 - 125, y - 435, x2 - 20, y - 450, 1, "Fancy Imagination", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_FANCY_IMAGINATION], xpProperty_ButtonType, xpPushButton);
-            y += 2;
-
-            // add sixties normal preset button
-            presetButtons[PRESET_SIXTIES] = XPCreateWidget(x2 - 20 - 125, y - 460, x2 - 20, y - 475, 1, "Sixties", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_SIXTIES], xpProperty_ButtonType, xpPushButton);
-            y += 2;
-
-            // add cold winter preset button
-            presetButtons[PRESET_COLD_WINTER] = XPCreateWidget(x2 - 20 - 125, y - 485, x2 - 20, y - 500, 1, "Cold Winter", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_COLD_WINTER], xpProperty_ButtonType, xpPushButton);
-            y += 2;
-
-            // add vintage film preset button
-            presetButtons[PRESET_VINTAGE_FILM] = XPCreateWidget(x2 - 20 - 125, y - 510, x2 - 20, y - 525, 1, "Vintage Film", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_VINTAGE_FILM], xpProperty_ButtonType, xpPushButton);
-            y += 2;
-
-            // add colorless preset button
-            presetButtons[PRESET_COLORLESS] = XPCreateWidget(x2 - 20 - 125, y - 535, x2 - 20, y - 550, 1, "Colorless", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_COLORLESS], xpProperty_ButtonType, xpPushButton);
-            y += 2;
-
-            // add monochrome preset button
-            presetButtons[PRESET_MONOCHROME] = XPCreateWidget(x2 - 20 - 125, y - 560, x2 - 20, y - 575, 1, "Monochrome", 0, settingsWidget, xpWidgetClass_Button);
-            XPSetWidgetProperty(presetButtons[PRESET_MONOCHROME], xpProperty_ButtonType, xpPushButton);
+
+            // add preset catalog buttons, one column after the other (captions are filled in for the current page)
+            for (int i = 0; i < PRESET_PAGE_SIZE; i++)
+            {
+                int row = i % (PRESET_PAGE_SIZE / 2);
+                int left = (i < PRESET_PAGE_SIZE / 2 ? x + 20 : x2 - 20 - 125);
+
+                y = top + 2 * row;
+                presetPageButtons[i] = XPCreateWidget(left, y - 360 - 25 * row, left + 125, y - 375 - 25 * row, 1, "", 0, settingsWidget, xpWidgetClass_Button);
+                XPSetWidgetProperty(presetPageButtons[i], xpProperty_ButtonType, xpPushButton);
+            }
+
+            y = top + 2 * (PRESET_PAGE_SIZE / 2);
+
+            // add previous/next page buttons and page caption below the catalog buttons
+            const int pageRow = 360 + 25 * (PRESET_PAGE_SIZE / 2);
+            presetPreviousPageButton = XPCreateWidget(x + 20, y - pageRow, x + 20 + 40, y - pageRow - 15, 1, "<", 0, settingsWidget, xpWidgetClass_Button);
+            XPSetWidgetProperty(presetPreviousPageButton, xpProperty_ButtonType, xpPushButton);
+            presetPageCaption = XPCreateWidget(x + 20 + 40 + 30, y - pageRow, x2 - 20 - 40 - 10, y - pageRow - 15, 1, "", 0, settingsWidget, xpWidgetClass_Caption);
+            presetNextPageButton = XPCreateWidget(x2 - 20 - 40, y - pageRow, x2 - 20, y - pageRow - 15, 1, ">", 0, settingsWidget, xpWidgetClass_Button);
+            XPSetWidgetProperty(presetNextPageButton, xpProperty_ButtonType, xpPushButton);
 
             x -= BUTTON_INSET; x2 += BUTTON_INSET;  // re-expand to normal width as we continue
-            y = top + 30;
+            y = top;
+
+            // add preset transition time caption
+            char stringTransitionTime[32];
+            snprintf(stringTransitionTime, 32, "Transition: %.1f sec", transitionTime);
+            transitionTimeCaption = XPCreateWidget(x + 30, y - 589, x2 - 50, y - 604, 1, stringTransitionTime, 0, settingsWidget, xpWidgetClass_Caption);
+
+            // add preset transition time slider (in tenths of a second)
+            transitionTimeSlider = XPCreateWidget(x + 195, y - 589, x2 - 15, y - 604, 1, "Transition", 0, settingsWidget, xpWidgetClass_ScrollBar);
+            XPSetWidgetProperty(transitionTimeSlider, xpProperty_ScrollBarMin, 0);
+            XPSetWidgetProperty(transitionTimeSlider, xpProperty_ScrollBarMax, 50);
+
+            y = top + 30 - 23 - 22; // leave room for the page and transition rows below the catalog buttons
 
             // Restore left/right margin from whole section above:
             x -= 3;
@@ -1576,9 +4152,14 @@ void MenuHandlerCallback(void *inMenuRef, void *inItemRef)
             XPCreateWidget(x + 10, y - 700, x2 - 20, y - 715, 1, "FPS-Limiter:", 0, settingsWidget, xpWidgetClass_Caption);
             
             // add fps-limiter checkbox
-            fpsLimiterCheckbox = XPCreateWidget(x + 20, y - 720, x2 - 20, y - 735, 1, "Enable FPS-Limiter", 0, settingsWidget, xpWidgetClass_Button);
+            fpsLimiterCheckbox = XPCreateWidget(x + 20, y - 720, x + 190, y - 735, 1, "Enable FPS-Limiter", 0, settingsWidget, xpWidgetClass_Button);
             XPSetWidgetProperty(fpsLimiterCheckbox, xpProperty_ButtonType, xpRadioButton);
             XPSetWidgetProperty(fpsLimiterCheckbox, xpProperty_ButtonBehavior, xpButtonBehaviorCheckBox);
+
+            // add adaptive fps checkbox (its caption shows the cap chosen by the adaptive mode)
+            adaptiveFpsCheckbox = XPCreateWidget(x + 195, y - 720, x2 - 20, y - 735, 1, "Adaptive", 0, settingsWidget, xpWidgetClass_Button);
+            XPSetWidgetProperty(adaptiveFpsCheckbox, xpProperty_ButtonType, xpRadioButton);
+            XPSetWidgetProperty(adaptiveFpsCheckbox, xpProperty_ButtonBehavior, xpButtonBehaviorCheckBox);
             
             // add max fps caption
             char stringMaxFps[32];
@@ -1651,7 +4232,9 @@ void MenuHandlerCallback(void *inMenuRef, void *inItemRef)
             x -= 2;
             x2 += 2;
 
-            // init checkbox and slider positions
+            // init preset catalog page, checkbox and slider positions
+            UpdatePresetCatalogWidgets();
+            InvalidateSettingsWidgets();
             UpdateSettingsWidgets();
 
             // register widget handler
@@ -1663,6 +4246,8 @@ void MenuHandlerCallback(void *inMenuRef, void *inItemRef)
             if (!XPIsWidgetVisible(settingsWidget))
                 XPShowWidget(settingsWidget);
         }
+
+        layoutStale = 1;    // check the position of the settings widget once it is shown
     }
 }
 
@@ -1674,11 +4259,28 @@ static void HandleKey(XPLMWindowID inWindowID, char inKey, XPLMKeyFlags inFlags,
 {
 }
 
+// returns whether the compare view shows a split, which can then be dragged on screen
+static inline bool CompareSplitShown(void)
+{
+    return postProcesssingEnabled && frameState.settingsWindowOpen && (compareMode == COMPARE_SPLIT || compareMode == COMPARE_PRESETS);
+}
+
 static int HandleMouseClick(XPLMWindowID inWindowID, int x, int y, XPLMMouseStatus inMouse, void *inRefcon)
 {
-    lastMouseUsageTime = XPLMGetElapsedTime();
+    NoteMouseUsage();
 
-    return 0;
+    // a click near the split of the compare view drags it, all other clicks go through to X-Plane; the mouse is in
+    // boxels of the fake window, which covers the screen, so the split is kept as a fraction of the screen width
+    if (inMouse == xplm_MouseDown)
+        compareDragging = CompareSplitShown() && abs(x - (int) (compareSplit * frameState.screenWidth)) <= COMPARE_GRAB_DISTANCE;
+    if (!compareDragging)
+        return 0;
+
+    compareSplit = minMax(0.0f, (float) x / (float) std::max(1, frameState.screenWidth), 1.0f);
+    if (inMouse == xplm_MouseUp)
+        compareDragging = 0;
+
+    return 1;
 }
 
 static XPLMCursorStatus HandleCursor(XPLMWindowID inWindowID, int x, int y, void *inRefcon)
@@ -1687,7 +4289,7 @@ static XPLMCursorStatus HandleCursor(XPLMWindowID inWindowID, int x, int y, void
 
     if (x != lastX || y != lastY)
     {
-        lastMouseUsageTime = XPLMGetElapsedTime();
+        NoteMouseUsage();
         lastX = x;
         lastY = y;
     }
@@ -1697,14 +4299,574 @@ static XPLMCursorStatus HandleCursor(XPLMWindowID inWindowID, int x, int y, void
 
 static int HandleMouseWheel(XPLMWindowID inWindowID, int x, int y, int wheel, int clicks, void *inRefcon)
 {
-    lastMouseUsageTime = XPLMGetElapsedTime();
+    NoteMouseUsage();
 
     return 0;
 }
 
+// returns the height of the immediate-mode settings window for the sections and the preset view shown
+static int SettingsWindowHeight(void)
+{
+    return SETTINGS_WINDOW_HEIGHT + (LEGACY_FEATURES ? SETTINGS_WINDOW_RALEIGH_HEIGHT : 0) + (presetThumbnailsEnabled ? SETTINGS_WINDOW_THUMBNAILS_HEIGHT : 0);
+}
+
+// keeps the top of the immediate-mode settings window in place and moves its bottom to fit the preset view shown
+static void ResizeSettingsWindow(void)
+{
+    int left, top, right, bottom;
+    XPLM_CALL(XPLMGetWindowGeometry(settingsWindow, &left, &top, &right, &bottom));
+    XPLM_CALL(XPLMSetWindowGeometry(settingsWindow, left, top, right, top - SettingsWindowHeight()));
+}
+
+// adds the caption and slider of a row of BLUfxSettingRows to the immediate-mode settings window
+static void SettingRowUi(BLUfxUi *ui, int i, int sliderLeft)
+{
+    const BLUfxSettingRow_t *row = &BLUfxSettingRows[i];
+    float value = (i < PARAM_MAX ? GetPendingParam(i) : *row->value);
+
+    char caption[32];
+    snprintf(caption, 32, row->format, value);
+    UiLabel(ui, UiContentLeft(ui), caption);
+
+    int position = SliderPosition(row, value);
+    if (UiSlider(ui, sliderLeft, UiContentRight(ui), &position, row->sliderMin, row->sliderMax))
+    {
+        value = position / row->sliderScale - row->sliderOffset;
+        if (i < PARAM_MAX)
+            SetPendingParam(i, value, 0);   // applied with the next frame, like a dataref write
+        else
+        {
+            *row->value = value;
+            if (i == SETTING_ROW_RALEIGH_SCALE)
+                UpdateRaleighScale(0);      // note: only happens in for pre-XP12 (otherwise no-op)
+        }
+    }
+
+    UiNextRow(ui);
+}
+
+// describes the immediate-mode settings window, same content and order as the settings widget and applying changes
+// right away through the same functions
+static void SettingsUi(BLUfxUi *ui)
+{
+    int left = UiContentLeft(ui), right = UiContentRight(ui);
+    int sliderLeft = left + 185, middle = (left + right) / 2, quarter = (right - left) / 4;
+    uint64_t fingerprint = CurrentFingerprint();
+    int value;
+
+    UiHeader(ui, "Post-Processing Settings:");
+    value = postProcesssingEnabled;
+    if (UiCheckbox(ui, left, "Enable Post-Processing", &value))
+        SetPostProcessingEnabled(value);
+    UiNextRow(ui);
+    for (int i = 0; i < PARAM_MAX; i++)
+        SettingRowUi(ui, i, sliderLeft);
+
+    if (UiButton(ui, left, left + quarter - 4, "Reset", true, presetFingerprints[PRESET_DEFAULT] == fingerprint))
+        ApplyPreset(&BLUfxPresets[PRESET_DEFAULT]);
+    if (UiButton(ui, left + quarter, left + 2 * quarter - 4, "Restore", true, presetFingerprints[PRESET_USER] == fingerprint))
+        ApplyPreset(&BLUfxPresets[PRESET_USER]);
+    if (UiButton(ui, left + 2 * quarter, left + 3 * quarter - 4, "Load .ini"))
+    {
+        LoadSettings();
+
+        // the values just loaded take precedence over a running transition
+        for (int i = 0; i < PARAM_MAX; i++)
+            PinTransitionParam(i);
+    }
+    if (UiButton(ui, left + 3 * quarter, right, "Save .ini"))
+        SaveSettings();
+    UiNextRow(ui, UI_ROW_HEIGHT + 6);
+
+    // one page of the preset catalog, as thumbnails in THUMBNAIL_COLUMNS columns or as buttons in two columns
+    value = presetThumbnailsEnabled;
+    if (UiCheckbox(ui, right - 92, "Thumbs", &value))
+    {
+        presetThumbnailsEnabled = value;
+        ResizeSettingsWindow();
+    }
+    UiHeader(ui, "Post-Processing Presets:");
+    UiLabel(ui, left, "Search:");
+    if (UiTextField(ui, sliderLeft, right, presetSearchText, sizeof(presetSearchText)))
+        FilterPresetCatalog(presetSearchText);
+    UiNextRow(ui);
+    int pageCount = std::max(1, (int) (presetCatalogView.size() + PRESET_PAGE_SIZE - 1) / PRESET_PAGE_SIZE);
+    presetCatalogPage = minMax(0, presetCatalogPage, pageCount - 1);
+    int tileWidth = (right - left - (THUMBNAIL_COLUMNS - 1) * 4) / THUMBNAIL_COLUMNS;
+    for (int i = 0; presetThumbnailsEnabled && i < PRESET_PAGE_SIZE; i += THUMBNAIL_COLUMNS)
+    {
+        for (int column = 0; column < THUMBNAIL_COLUMNS; column++)
+        {
+            size_t index = presetCatalogPage * PRESET_PAGE_SIZE + i + column;
+            if (index >= presetCatalogView.size())
+                continue;
+
+            // the tiles of the atlas are drawn in the same order, the image is left out until they are (black at first)
+            BLUfxCatalogEntry *entry = &presetCatalog[presetCatalogView[index]];
+            int tile = i + column, row = tile / THUMBNAIL_COLUMNS;
+            if (thumbnailEntries[tile] != presetCatalogView[index])
+                thumbnailsStale = 1;
+            float u0 = (float) column / THUMBNAIL_COLUMNS, v1 = 1.0f - (float) row / THUMBNAIL_ROWS;
+            int x0 = left + column * (tileWidth + 4);
+            if (UiImageButton(ui, x0, x0 + tileWidth, THUMBNAIL_TILE_HEIGHT, entry->name.c_str(), entry->loaded && entry->fingerprint == fingerprint, u0, v1 - 1.0f / THUMBNAIL_ROWS, u0 + 1.0f / THUMBNAIL_COLUMNS, v1))
+            {
+                BLUfxPreset *preset = LoadCatalogPreset(entry);
+                if (preset != NULL)
+                    ApplyPreset(preset);
+            }
+        }
+        UiNextRow(ui, THUMBNAIL_TILE_HEIGHT + 4);
+    }
+    for (int i = 0; !presetThumbnailsEnabled && i < PRESET_PAGE_SIZE; i += 2)
+    {
+        for (int column = 0; column < 2; column++)
+        {
+            size_t index = presetCatalogPage * PRESET_PAGE_SIZE + i + column;
+            if (index >= presetCatalogView.size())
+                continue;
+
+            BLUfxCatalogEntry *entry = &presetCatalog[presetCatalogView[index]];
+            int x0 = (column == 0 ? left : middle + 2), x1 = (column == 0 ? middle - 2 : right);
+            if (UiButton(ui, x0, x1, entry->name.c_str(), true, entry->loaded && entry->fingerprint == fingerprint))
+            {
+                BLUfxPreset *preset = LoadCatalogPreset(entry);
+                if (preset != NULL)
+                    ApplyPreset(preset);
+            }
+        }
+        UiNextRow(ui);
+    }
+    char page[48];
+    snprintf(page, 48, "Page %d / %d (%d presets)", presetCatalogPage + 1, pageCount, (int) presetCatalogView.size());
+    if (UiButton(ui, left, left + 40, "<", presetCatalogPage > 0))
+        presetCatalogPage--;
+    UiLabel(ui, (left + right - UiTextWidth(page)) / 2, page);
+    if (UiButton(ui, right - 40, right, ">", presetCatalogPage < pageCount - 1))
+        presetCatalogPage++;
+    UiNextRow(ui);
+    SettingRowUi(ui, SETTING_ROW_TRANSITION_TIME, sliderLeft);
+
+    // compare view while this window is open (the split can also be dragged on screen), the "B" side of the presets
+    // view is the user preset unless the current grade has been pinned
+    static const char *compareModeNames[COMPARE_MAX] = {"Off", "Split", "Presets", "Diff"};
+    UiHeader(ui, "Compare:");
+    for (int i = 0; i < COMPARE_MAX; i++)
+    {
+        if (UiButton(ui, left + i * quarter, (i == COMPARE_MAX - 1 ? right : left + (i + 1) * quarter - 4), compareModeNames[i], true, compareMode == i))
+            compareMode = i;
+    }
+    UiNextRow(ui);
+    char split[32];
+    snprintf(split, 32, "Split: %.0f%%", compareSplit * 100.0f);
+    UiLabel(ui, left, split);
+    int position = (int) lrintf(compareSplit * 100.0f);
+    if (UiSlider(ui, sliderLeft, right - quarter, &position, 0, 100))
+        compareSplit = position / 100.0f;
+    if (UiButton(ui, right - quarter + 4, right, comparePinned ? "Unpin B" : "Pin B"))
+    {
+        comparePinned = !comparePinned;
+        for (int i = 0; comparePinned && i < PARAM_MAX; i++)
+            comparePinnedParams[i] = GetPendingParam(i);
+    }
+    UiNextRow(ui);
+
+    if (LEGACY_FEATURES)
+    {
+        // Raleigh is not a thing in XP12, so this is only for pre-XP12:
+        UiHeader(ui, "Raleigh Scale:");
+        SettingRowUi(ui, SETTING_ROW_RALEIGH_SCALE, sliderLeft);
+        if (UiButton(ui, left, left + quarter - 4, "Reset"))
+        {
+            raleighScale = DEFAULT_RALEIGH_SCALE;
+            UpdateRaleighScale(1);
+        }
+        UiNextRow(ui);
+    }
+
+    UiHeader(ui, "FPS-Limiter:");
+    value = fpsLimiterEnabled;
+    if (UiCheckbox(ui, left, "Enable FPS-Limiter", &value))
+        SetFpsLimiterEnabled(value);
+    char adaptive[32];
+    if (adaptiveFpsEnabled && fpsLimiterEnabled)
+        snprintf(adaptive, 32, "Adaptive: %.0f FPS", adaptiveFps);
+    else
+        snprintf(adaptive, 32, "Adaptive");
+    value = adaptiveFpsEnabled;
+    if (UiCheckbox(ui, sliderLeft, adaptive, &value))
+        SetAdaptiveFpsEnabled(value);
+    UiNextRow(ui);
+    SettingRowUi(ui, SETTING_ROW_MAX_FPS, sliderLeft);
+
+    UiHeader(ui, "Auto disable / enable Cinema Verite:");
+    value = controlCinemaVeriteEnabled;
+    if (UiCheckbox(ui, left, "Control Cinema Verite", &value))
+        SetControlCinemaVeriteEnabled(value);
+    UiNextRow(ui);
+    SettingRowUi(ui, SETTING_ROW_DISABLE_CINEMA_VERITE_TIME, sliderLeft);
+}
+
+// creates the texture of the UI font atlas when first needed (by the settings window or the HUD)
+static void CreateUiFontTexture(void)
+{
+    if (uiFontTexture == 0)
+    {
+        static unsigned char atlas[UI_ATLAS_WIDTH * UI_ATLAS_HEIGHT * 4];
+        UiBuildFontAtlas(atlas);
+        XPLM_CALL(XPLMGenerateTextureNumbers(&uiFontTexture, 1));
+        XPLM_CALL(XPLMBindTexture2d(uiFontTexture, 0));
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, UI_ATLAS_WIDTH, UI_ATLAS_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, atlas);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+}
+
+// draw-callback of the immediate-mode settings window: describes the window and draws it with one draw call, plus one
+// for the preset thumbnails while they are shown
+static void DrawSettingsWindow(XPLMWindowID inWindowID, void *)
+{
+    int left, top, right, bottom;
+    XPLM_CALL(XPLMGetWindowGeometry(inWindowID, &left, &top, &right, &bottom));
+
+    CreateUiFontTexture();
+
+    UiBegin(&settingsUi, left, top, right, bottom);
+    SettingsUi(&settingsUi);
+    UiEnd(&settingsUi);
+
+    // the window takes the keyboard while the search field has the focus and gives it back afterwards
+    if ((settingsUi.focusedId != 0) != settingsWindowHasKeyboard)
+    {
+        settingsWindowHasKeyboard = (settingsUi.focusedId != 0);
+        XPLM_CALL(XPLMTakeKeyboardFocus(settingsWindowHasKeyboard ? inWindowID : 0));
+    }
+
+    XPLM_CALL(XPLMSetGraphicsState(0, 1, 0, 1, 1, 0, 0));
+    XPLM_CALL(XPLMBindTexture2d(uiFontTexture, 0));
+
+    const BLUfxUiVertex *vertices = settingsUi.vertices.data();
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, sizeof(BLUfxUiVertex), &vertices->x);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(BLUfxUiVertex), &vertices->u);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(BLUfxUiVertex), &vertices->color);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei) settingsUi.vertices.size());
+
+    // the thumbnails go on top, with the atlas (only once it exists)
+    if (!settingsUi.images.empty() && thumbnailMode > THUMBNAILS_NOT_INITIALIZED)
+    {
+        vertices = settingsUi.images.data();
+        XPLM_CALL(XPLMBindTexture2d(thumbnailAtlasTexture, 0));
+        glVertexPointer(2, GL_FLOAT, sizeof(BLUfxUiVertex), &vertices->x);
+        glTexCoordPointer(2, GL_FLOAT, sizeof(BLUfxUiVertex), &vertices->u);
+        glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(BLUfxUiVertex), &vertices->color);
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei) settingsUi.images.size());
+    }
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+// mouse-click handler of the immediate-mode settings window, the click is handled when the window is drawn next
+static int HandleSettingsWindowClick(XPLMWindowID, int x, int y, XPLMMouseStatus inMouse, void *)
+{
+    settingsUi.mouseX = x;
+    settingsUi.mouseY = y;
+    if (inMouse == xplm_MouseDown)
+    {
+        settingsUi.mouseDown = 1;
+        settingsUi.mousePressed = 1;
+    }
+    else if (inMouse == xplm_MouseUp)
+    {
+        settingsUi.mouseDown = 0;
+        settingsUi.mouseReleased = 1;
+    }
+
+    return 1;
+}
+
+// key handler of the immediate-mode settings window, the keys go to the focused text field when the window is drawn next
+static void HandleSettingsWindowKey(XPLMWindowID, char inKey, XPLMKeyFlags inFlags, char inVirtualKey, void *, int losingFocus)
+{
+    if (losingFocus)
+    {
+        settingsUi.focusedId = 0;
+        settingsWindowHasKeyboard = false;
+    }
+    else if (inFlags & xplm_DownFlag)
+    {
+        unsigned char virtualKey = (unsigned char) inVirtualKey;
+        if (virtualKey == XPLM_VK_BACK)
+            UiTypeKey(&settingsUi, UI_KEY_BACKSPACE);
+        else if (virtualKey == XPLM_VK_RETURN || virtualKey == XPLM_VK_ENTER)
+            UiTypeKey(&settingsUi, UI_KEY_RETURN);
+        else if (virtualKey == XPLM_VK_ESCAPE)
+            UiTypeKey(&settingsUi, UI_KEY_ESCAPE);
+        else
+            UiTypeKey(&settingsUi, inKey);
+    }
+}
+
+static XPLMCursorStatus HandleSettingsWindowCursor(XPLMWindowID, int x, int y, void *)
+{
+    settingsUi.mouseX = x;
+    settingsUi.mouseY = y;
+
+    return xplm_CursorDefault;
+}
+
+static int HandleSettingsWindowMouseWheel(XPLMWindowID, int, int, int, int, void *)
+{
+    return 1;
+}
+
+// shows or hides the immediate-mode settings window, which is created when first shown
+static void ShowSettingsWindow(int visible)
+{
+    if (settingsWindow == NULL)
+    {
+        if (!visible)
+            return;
+
+        int screenLeft = 0, screenTop = 0, screenRight = 0, screenBottom = 0;
+        XPLM_CALL(XPLMGetScreenBoundsGlobal(&screenLeft, &screenTop, &screenRight, &screenBottom));
+
+        XPLMCreateWindow_t settingsWindowParameters;
+        memset(&settingsWindowParameters, 0, sizeof(settingsWindowParameters));
+        settingsWindowParameters.structSize = sizeof(settingsWindowParameters);
+        settingsWindowParameters.left = screenLeft + 30;
+        settingsWindowParameters.top = screenTop - 60;
+        settingsWindowParameters.right = settingsWindowParameters.left + SETTINGS_WINDOW_WIDTH;
+        settingsWindowParameters.bottom = settingsWindowParameters.top - SettingsWindowHeight();
+        settingsWindowParameters.visible = 1;
+        settingsWindowParameters.drawWindowFunc = DrawSettingsWindow;
+        settingsWindowParameters.handleKeyFunc = HandleSettingsWindowKey;
+        settingsWindowParameters.handleMouseClickFunc = HandleSettingsWindowClick;
+        settingsWindowParameters.handleRightClickFunc = HandleSettingsWindowClick;
+        settingsWindowParameters.handleCursorFunc = HandleSettingsWindowCursor;
+        settingsWindowParameters.handleMouseWheelFunc = HandleSettingsWindowMouseWheel;
+        settingsWindowParameters.decorateAsFloatingWindow = xplm_WindowDecorationRoundRectangle;
+        settingsWindowParameters.layer = xplm_WindowLayerFloatingWindows;
+        settingsWindow = XPLM_CALL(XPLMCreateWindowEx(&settingsWindowParameters));
+
+        XPLMSetWindowPositioningMode(settingsWindow, xplm_WindowPositionFree, -1);
+        XPLMSetWindowTitle(settingsWindow, NAME " v" VERSION " - Settings");
+    }
+    else
+    {
+        if (!visible && settingsWindowHasKeyboard)
+            XPLM_CALL(XPLMTakeKeyboardFocus(0));
+        XPLMSetWindowIsVisible(settingsWindow, visible);
+    }
+}
+
+// issues the timestamp before (end = 0) or after (end = 1) the post-processing pass for the HUD, unless all queries
+// are still in flight
+static void MarkHudGpuTime(int end)
+{
+    if (hud.queries[0][0] == 0 || (!end && hud.queryCount == HUD_GPU_QUERIES) || (end && !hud.queryStarted))
+        return;
+
+    glQueryCounterProc(hud.queries[(hud.queryFirst + hud.queryCount) % HUD_GPU_QUERIES][end], BLUFX_GL_TIMESTAMP);
+    hud.queryStarted = !end;
+    if (end)
+        hud.queryCount++;
+}
+
+// adds the GPU times of the post-processing passes that are done (oldest first, without waiting)
+static void PollHudGpuTimes(void)
+{
+    while (hud.queryCount > 0)
+    {
+        GLuint *queries = hud.queries[hud.queryFirst];
+        GLint available = 0;
+        glGetQueryObjectivProc(queries[1], BLUFX_GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return;
+
+        BLUfxGLuint64 start = 0, end = 0;
+        glGetQueryObjectui64vProc(queries[0], BLUFX_GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64vProc(queries[1], BLUFX_GL_QUERY_RESULT, &end);
+        hud.gpuTimeSum += (end - start) * 1.0e-6;
+        hud.gpuFrames++;
+        hud.queryFirst = (hud.queryFirst + 1) % HUD_GPU_QUERIES;
+        hud.queryCount--;
+    }
+}
+
+// returns the size of the textures of BLU-fx in bytes
+static long OwnTextureBytes(void)
+{
+    long bytes = (long) lastResolutionX * lastResolutionY * 4;
+    if (uiFontTexture != 0)
+        bytes += UI_ATLAS_WIDTH * UI_ATLAS_HEIGHT * 4;
+    if (thumbnailAtlasTexture != 0)
+        bytes += (2 * THUMBNAIL_WIDTH * 2 * THUMBNAIL_HEIGHT + THUMBNAIL_COLUMNS * THUMBNAIL_WIDTH * THUMBNAIL_ROWS * THUMBNAIL_HEIGHT) * 4;
+
+    return bytes;
+}
+
+// formats the VRAM line of the HUD, as far as the driver reports the VRAM use
+static void FormatHudVram(char *line, int size)
+{
+    if (hud.vramInfo == VRAM_INFO_UNKNOWN)
+    {
+        const char *extensions = (const char *) glGetString(GL_EXTENSIONS);
+        if (extensions != NULL && strstr(extensions, "GL_NVX_gpu_memory_info") != NULL)
+            hud.vramInfo = VRAM_INFO_NVX;
+        else if (extensions != NULL && strstr(extensions, "GL_ATI_meminfo") != NULL)
+            hud.vramInfo = VRAM_INFO_ATI;
+        else
+            hud.vramInfo = VRAM_INFO_NONE;
+    }
+
+    float own = OwnTextureBytes() / (1024.0f * 1024.0f);
+    if (hud.vramInfo == VRAM_INFO_NVX)
+    {
+        GLint total = 0, available = 0;
+        glGetIntegerv(BLUFX_GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &total);
+        glGetIntegerv(BLUFX_GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &available);
+        snprintf(line, size, "VRAM    %d / %d MB, own %.0f MB", (total - available) / 1024, total / 1024, own);
+    }
+    else if (hud.vramInfo == VRAM_INFO_ATI)
+    {
+        GLint freeMemory[4] = {0};
+        glGetIntegerv(BLUFX_GL_TEXTURE_FREE_MEMORY_ATI, freeMemory);
+        snprintf(line, size, "VRAM    %d MB free, own %.0f MB", freeMemory[0] / 1024, own);
+    }
+    else
+        snprintf(line, size, "VRAM    own %.0f MB", own);
+}
+
+// draw-callback of the performance HUD, drawn after the post-processing pass (and the windows)
+static int HudCallback(XPLMDrawingPhase, int, void *)
+{
+    int x = frameState.screenWidth, y = frameState.screenHeight;
+
+    // collect this frame's numbers, and update the text every HUD_TEXT_INTERVAL seconds
+    float frameTime = (frameStats.count > 0 ? frameStats.frameTimes[(frameStats.next + FRAME_STATS_WINDOW - 1) % FRAME_STATS_WINDOW] : 0.0f);
+    hud.frameTimeSum += frameTime;
+    hud.sleepSum += limiterSleepTime;
+    hud.frames++;
+    if (hud.queries[0][0] != 0)
+        PollHudGpuTimes();
+
+    double now = GetMonotonicTime();
+    if (now >= hud.textTime + HUD_TEXT_INTERVAL)
+    {
+        float averageFrameTime = (float) (hud.frameTimeSum / hud.frames);
+        snprintf(hud.lines[0], 64, "Frame  %5.1f ms (%.0f FPS)", averageFrameTime, averageFrameTime > 0.0f ? 1000.0f / averageFrameTime : 0.0f);
+        snprintf(hud.lines[1], 64, "Sleep  %5.1f ms", hud.sleepSum / hud.frames);
+        if (hud.gpuFrames > 0)
+            snprintf(hud.lines[2], 64, "GPU    %5.2f ms (post-processing)", hud.gpuTimeSum / hud.gpuFrames);
+        else
+            snprintf(hud.lines[2], 64, "GPU    n/a");
+        FormatHudVram(hud.lines[3], 64);
+
+        hud.textTime = now;
+        hud.frameTimeSum = hud.sleepSum = hud.gpuTimeSum = 0.0;
+        hud.frames = hud.gpuFrames = 0;
+    }
+
+    // describe the HUD: the numbers, then the graph with a line at the frame time of the cap (or 60 FPS)
+    int right = x - HUD_MARGIN, top = y - HUD_MARGIN, left = right - HUD_WIDTH;
+    int bottom = top - 2 * UI_PADDING - HUD_LINES * UI_ROW_HEIGHT - HUD_GRAPH_HEIGHT;
+    UiBegin(&hud.ui, left, top, right, bottom);
+    for (int i = 0; i < HUD_LINES; i++)
+    {
+        UiLabel(&hud.ui, UiContentLeft(&hud.ui), hud.lines[i]);
+        UiNextRow(&hud.ui);
+    }
+    float graphBottom = (float) (bottom + UI_PADDING), scale = HUD_GRAPH_HEIGHT / HUD_GRAPH_MAX_FRAME_TIME;
+    float cap = GetFpsCap(), target = 1000.0f / (cap > 0.0f ? cap : 60.0f);
+    int frames = std::min(frameStats.count, HUD_GRAPH_FRAMES);
+    for (int i = 0; i < frames; i++)
+    {
+        float time = frameStats.frameTimes[(frameStats.next + FRAME_STATS_WINDOW - frames + i) % FRAME_STATS_WINDOW];
+        float barLeft = (float) (right - UI_PADDING - 2 * (frames - i));
+        UiRect(&hud.ui, barLeft, graphBottom, barLeft + 2.0f, graphBottom + std::min(time * scale, (float) HUD_GRAPH_HEIGHT), time > target * 1.5f ? UI_RGBA(230, 120, 60, 255) : UI_COLOR_ITEM_ACTIVE);
+    }
+    float targetY = graphBottom + std::min(target * scale, (float) HUD_GRAPH_HEIGHT);
+    UiRect(&hud.ui, (float) UiContentLeft(&hud.ui), targetY, (float) UiContentRight(&hud.ui), targetY + 1.0f, UI_COLOR_LINE);
+
+    // draw it in screen boxels (the ortho projection spans the boxel screen size) from the vertex buffer
+    CreateUiFontTexture();
+    XPLM_CALL(XPLMSetGraphicsState(0, 1, 0, 1, 1, 0, 0));
+    XPLM_CALL(XPLMBindTexture2d(uiFontTexture, 0));
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0.0f, x, 0.0f, y, -1.0f, 1.0f);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glBindBuffer(GL_ARRAY_BUFFER, hud.buffer);
+    glBufferData(GL_ARRAY_BUFFER, hud.ui.vertices.size() * sizeof(BLUfxUiVertex), hud.ui.vertices.data(), GL_STREAM_DRAW);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, sizeof(BLUfxUiVertex), (const void *) offsetof(BLUfxUiVertex, x));
+    glTexCoordPointer(2, GL_FLOAT, sizeof(BLUfxUiVertex), (const void *) offsetof(BLUfxUiVertex, u));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(BLUfxUiVertex), (const void *) offsetof(BLUfxUiVertex, color));
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei) hud.ui.vertices.size());
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+
+    return 1;
+}
+
+// shows or hides the performance HUD: registers its draw callback and creates (or deletes) its buffer and queries
+static void SetHudEnabled(int enabled)
+{
+    if (enabled == hudEnabled)
+        return;
+
+    hudEnabled = enabled;
+    if (enabled)
+    {
+        hud.queryFirst = hud.queryCount = hud.queryStarted = 0;
+        hud.textTime = 0.0;
+        hud.frameTimeSum = hud.sleepSum = hud.gpuTimeSum = 0.0;
+        hud.frames = hud.gpuFrames = 0;
+        glGenBuffers(1, &hud.buffer);
+        if (LoadTimerQueryFunctions())
+            glGenQueriesProc(2 * HUD_GPU_QUERIES, &hud.queries[0][0]);
+        XPLMRegisterDrawCallback(HudCallback, xplm_Phase_Window, 0, NULL);
+    }
+    else
+    {
+        XPLMUnregisterDrawCallback(HudCallback, xplm_Phase_Window, 0, NULL);
+        if (hud.queries[0][0] != 0)
+            glDeleteQueriesProc(2 * HUD_GPU_QUERIES, &hud.queries[0][0]);
+        memset(hud.queries, 0, sizeof(hud.queries));
+        glDeleteBuffers(1, &hud.buffer);
+        hud.buffer = 0;
+    }
+}
+
+int toggleHudHandler(XPLMCommandRef, XPLMCommandPhase inPhase, void *)
+{
+    if (inPhase == xplm_CommandBegin)
+        SetHudEnabled(!hudEnabled);
+
+    return 1;   // allow others to listen to this command if they like
+}
+
 int toggleSettingsHandler(XPLMCommandRef inCommand, XPLMCommandPhase inPhase, void *inRefcon)
 {
-    if (inPhase == xplm_CommandBegin) {
+    if (inPhase == xplm_CommandBegin && modernSettingsWindow)
+        ShowSettingsWindow(settingsWindow == NULL || !XPLMGetWindowIsVisible(settingsWindow));
+    else if (inPhase == xplm_CommandBegin) {
         if (settingsWidget && XPIsWidgetVisible(settingsWidget))
             XPHideWidget(settingsWidget);       // toggle display off
         else
@@ -1724,49 +4886,87 @@ PLUGIN_API int XPluginStart(char *outName, char *outSig, char *outDesc)
 #else
     strcpy(outDesc, NAME_VERSION " built on " __DATE__ ".");
 #endif
+
+    // log records are queued from here on and written once per frame (see FlushLogTask)
+    InitLog(&logQueue, logLevel);
     
     // Update widgets library to use modern windows:
     // (Note: this allows users with UI Zoom to get correct results!)
     XPLMEnableFeature("XPLM_USE_NATIVE_WIDGET_WINDOWS", 1);	// depends on XPLM301+
     
+    // resolve all datarefs of X-Plane used by the plugin
+    int resolvedDataRefs = ResolveDataRefs(1);
+
     // Get version of X-Plane:
-    xplmVersionNum = XPLMGetDatai(xplmVersionDataRef);
-    XPLMDebugString(NAME_VERSION ": Initializing " NAME_LOWERCASE " plugin (v" VERSION ", 64-bit):\n");
-    XPLMDebugString(NAME_VERSION_BLANK "This updated version supports modern graphics drivers for both\n");
-    XPLMDebugString(NAME_VERSION_BLANK "X-Plane 11 and X-Plane 12, and will run on X-Plane 11 in OpenGL\n");
-    XPLMDebugString(NAME_VERSION_BLANK "as well as Vulkan/Metal. (Please note: as this binary is 64-bit\n");
-    XPLMDebugString(NAME_VERSION_BLANK "only. As such, X-Plane 10 and older XP versions are no longer\n");
-    XPLMDebugString(NAME_VERSION_BLANK "supported by " NAME ", starting with v1.1 and later.)\n");
+    xplmVersionNum = xplmVersionDataRef != NULL ? XPLMGetDatai(xplmVersionDataRef) : 0;
+    LogWrite(&logQueue, LOG_INFO, NAME_VERSION ": Initializing " NAME_LOWERCASE " plugin (v" VERSION ", 64-bit):\n"
+                                  NAME_VERSION_BLANK "This updated version supports modern graphics drivers for both\n"
+                                  NAME_VERSION_BLANK "X-Plane 11 and X-Plane 12, and will run on X-Plane 11 in OpenGL\n"
+                                  NAME_VERSION_BLANK "as well as Vulkan/Metal. (Please note: as this binary is 64-bit\n"
+                                  NAME_VERSION_BLANK "only. As such, X-Plane 10 and older XP versions are no longer\n"
+                                  NAME_VERSION_BLANK "supported by " NAME ", starting with v1.1 and later.)\n");
 #if APL /* Let users know a little more about the Mac build if they are on macOS: */
-    XPLMDebugString(NAME_VERSION ": Special notice for macOS users:\n");
-    XPLMDebugString(NAME_VERSION_BLANK "This is a notarized \"universal\" binary, for macOS on both Intel\n");
-    XPLMDebugString(NAME_VERSION_BLANK "and Apple Silicon, built by Steve Goldberg (PM @slgoldberg on\n");
-    XPLMDebugString(NAME_VERSION_BLANK "X-Plane.org forums). " NAME " v1.0 was created by Matteo Hausner,\n");
-    XPLMDebugString(NAME_VERSION_BLANK "with all future updates from v1.1 onward (including this release)\n");
-    XPLMDebugString(NAME_VERSION_BLANK "by Steve Goldberg. From both of us: you're welcome!\n");
+    LogWrite(&logQueue, LOG_INFO, NAME_VERSION ": Special notice for macOS users:\n"
+                                  NAME_VERSION_BLANK "This is a notarized \"universal\" binary, for macOS on both Intel\n"
+                                  NAME_VERSION_BLANK "and Apple Silicon, built by Steve Goldberg (PM @slgoldberg on\n"
+                                  NAME_VERSION_BLANK "X-Plane.org forums). " NAME " v1.0 was created by Matteo Hausner,\n"
+                                  NAME_VERSION_BLANK "with all future updates from v1.1 onward (including this release)\n"
+                                  NAME_VERSION_BLANK "by Steve Goldberg. From both of us: you're welcome!\n");
 #else   /* Show this general multi-line "about" message for Linux and Windows builds: */
-    XPLMDebugString(NAME_VERSION ": About this release (" NAME_LOWERCASE ".xpl version " VERSION "):\n");
-    XPLMDebugString(NAME_VERSION_BLANK "This updated 64-bit version is distributed in the modern X-Plane\n");
-    XPLMDebugString(NAME_VERSION_BLANK "universal plugin binary format, and includes feature improvements,\n");
-    XPLMDebugString(NAME_VERSION_BLANK "all of which were added by Steve Goldberg (PM @slgoldberg on the\n");
-    XPLMDebugString(NAME_VERSION_BLANK "X-Plane.org forums), with the original plugin created by Matteo\n");
-    XPLMDebugString(NAME_VERSION_BLANK "Hausner). From both of us: you're welcome!");
+    LogWrite(&logQueue, LOG_INFO, NAME_VERSION ": About this release (" NAME_LOWERCASE ".xpl version " VERSION "):\n"
+                                  NAME_VERSION_BLANK "This updated 64-bit version is distributed in the modern X-Plane\n"
+                                  NAME_VERSION_BLANK "universal plugin binary format, and includes feature improvements,\n"
+                                  NAME_VERSION_BLANK "all of which were added by Steve Goldberg (PM @slgoldberg on the\n"
+                                  NAME_VERSION_BLANK "X-Plane.org forums), with the original plugin created by Matteo\n"
+                                  NAME_VERSION_BLANK "Hausner). From both of us: you're welcome!\n");
 #endif
     
     // prepare fragment-shader
     InitShader(FRAGMENT_SHADER);
 
-    // obtain datarefs
-    cinemaVeriteDataRef = XPLMFindDataRef("sim/graphics/view/cinema_verite");
-    viewTypeDataRef = XPLMFindDataRef("sim/graphics/view/view_type");
-//    ignitionKeyDataRef = XPLMFindDataRef("sim/cockpit2/engine/actuators/ignition_key");	// no longer used
+    LogFormat(&logQueue, LOG_INFO, NAME_VERSION": Found %d of %d datarefs.\n", resolvedDataRefs, (int) (sizeof(dataRefBindings) / sizeof(dataRefBindings[0])));
+    if (HasSplitCinemaVerite())
+        LogWrite(&logQueue, LOG_INFO, NAME_VERSION": Controlling cinema verite through the interior and exterior datarefs.\n");
+    else
+        LogWrite(&logQueue, LOG_INFO, NAME_VERSION": Controlling cinema verite through the legacy dataref and the view type.\n");
 
     // register own dataref
     overrideControlCinemaVeriteDataRef = XPLMRegisterDataAccessor(NAME_LOWERCASE "/override_control_cinema_verite", xplmType_Int,  1, GetOverrideControlCinemaVeriteDataRefCallback, SetOverrideControlCinemaVeriteDataRefCallback,  NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
 
+    // register own datarefs for the grading parameters, individually and as one float array
+    for (int i = 0; i < PARAM_MAX; i++)
+    {
+        char paramDataRefName[64];
+        snprintf(paramDataRefName, 64, NAME_LOWERCASE "/%s", BLUfxParams[i].name);
+        paramDataRefs[i] = XPLMRegisterDataAccessor(paramDataRefName, xplmType_Float, 1, NULL, NULL, GetParamDataRefCallback, SetParamDataRefCallback, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, (void *) (intptr_t) i, (void *) (intptr_t) i);
+    }
+    paramsDataRef = XPLMRegisterDataAccessor(NAME_LOWERCASE "/params", xplmType_FloatArray, 1, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, GetParamsDataRefCallback, SetParamsDataRefCallback, NULL, NULL, NULL, NULL);
+
+    // register own read-only datarefs for the frame-time statistics
+    static const char *statDataRefNames[STAT_MAX] = {"frame_time_p50", "frame_time_p90", "frame_time_p95", "frame_time_p99", "fps_average", "fps_1_percent_low"};
+    for (int i = 0; i < STAT_MAX; i++)
+    {
+        char statDataRefName[64];
+        snprintf(statDataRefName, 64, NAME_LOWERCASE "/stats/%s", statDataRefNames[i]);
+        statsDataRefs[i] = XPLMRegisterDataAccessor(statDataRefName, xplmType_Float, 0, NULL, NULL, GetStatDataRefCallback, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, (void *) (intptr_t) i, NULL);
+    }
+    static const char *latencyDataRefNames[STAT_FRAME_TIME_P99 + 1] = {"input_latency_p50", "input_latency_p90", "input_latency_p95", "input_latency_p99"};
+    for (int i = STAT_FRAME_TIME_P50; i <= STAT_FRAME_TIME_P99; i++)
+    {
+        char latencyDataRefName[64];
+        snprintf(latencyDataRefName, 64, NAME_LOWERCASE "/stats/%s", latencyDataRefNames[i]);
+        latencyDataRefs[i] = XPLMRegisterDataAccessor(latencyDataRefName, xplmType_Float, 0, NULL, NULL, GetInputLatencyDataRefCallback, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, (void *) (intptr_t) i, NULL);
+    }
+    taskTimesDataRef = XPLMRegisterDataAccessor(NAME_LOWERCASE "/stats/task_times", xplmType_FloatArray, 0, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, GetTaskTimesDataRefCallback, NULL, NULL, NULL, NULL, NULL);
+    gpuWaitDataRef = XPLMRegisterDataAccessor(NAME_LOWERCASE "/stats/gpu_wait", xplmType_Float, 0, NULL, NULL, GetGpuWaitDataRefCallback, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    xplmCallsDataRef = XPLMRegisterDataAccessor(NAME_LOWERCASE "/stats/xplm_calls", xplmType_Int, 0, GetXplmCallsDataRefCallback, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    fpsCapDataRef = XPLMRegisterDataAccessor(NAME_LOWERCASE "/fps_cap", xplmType_Float, 0, NULL, NULL, GetFpsCapDataRefCallback, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+
     // register our own commandref
     XPLMCommandRef toggleSettingsCmd = XPLMCreateCommand(NAME_LOWERCASE "/toggle_settings", "toggle " NAME " settings window open/closed");
     XPLMRegisterCommandHandler(toggleSettingsCmd, toggleSettingsHandler, 1, NULL);
+    XPLMCommandRef toggleHudCmd = XPLMCreateCommand(NAME_LOWERCASE "/toggle_hud", "toggle " NAME " performance HUD on/off");
+    XPLMRegisterCommandHandler(toggleHudCmd, toggleHudHandler, 1, NULL);
     
     // create menu-entries
     int subMenuItem = XPLMAppendMenuItem(XPLMFindPluginsMenu(), NAME, 0, 1);
@@ -1778,9 +4978,15 @@ PLUGIN_API int XPluginStart(char *outName, char *outSig, char *outDesc)
     else
         XPLMAppendMenuItem(menu,"Settings", NULL, 1);
 
-    // read and apply config file
+    // read and apply config file (which also sets the user preset)
+    for (int i = 0; i < PRESET_MAX; i++)
+        UpdatePresetFingerprint(i);
     LoadSettings();
 
+    // index the preset library (values of on-disk presets are loaded on selection)
+    ScanPresetLibrary();
+    FilterPresetCatalog("");
+
     // create fake window
     XPLMCreateWindow_t fakeWindowParameters;
     // hack: XPLM300 windows seem to be unable to pass clicks through - the struct size defines which API version is used, by removing the parameters introduced with XPLM300 we can trick X-Plane into thinking we are an XPLM200 plugin for which the click passthrough works
@@ -1798,18 +5004,56 @@ PLUGIN_API int XPluginStart(char *outName, char *outSig, char *outDesc)
     fakeWindow = XPLMCreateWindowEx(&fakeWindowParameters);
     XPLMSetWindowPositioningMode(fakeWindow, xplm_WindowFullScreenOnAllMonitors, -1);
 
-    // register flight loop callbacks (note: the "fake window" callback is less frequent)
-    XPLMRegisterFlightLoopCallback(UpdateFakeWindowCallback, -6, NULL);
-    if (fpsLimiterEnabled)
-        XPLMRegisterFlightLoopCallback(LimiterFlightCallback, -1, NULL);
-    if (controlCinemaVeriteEnabled)
-        XPLMRegisterFlightLoopCallback(ControlCinemaVeriteCallback, -1, NULL);
+    // create the (on-demand) flight loop for preset transitions
+    XPLMCreateFlightLoop_t parameterFlightLoopParameters = {sizeof(XPLMCreateFlightLoop_t), xplm_FlightLoop_Phase_BeforeFlightModel, ParameterFlightLoopCallback, NULL};
+    parameterFlightLoop = XPLMCreateFlightLoop(&parameterFlightLoopParameters);
+
+    // create the scheduler flight loop and its tasks (note: the screen bounds are polled once per second, the sim
+    // context is only needed for the pause, replay and power caps, the limiter only runs while some cap applies)
+    ResetFrameStats(&frameStats);
+    ResetFrameStats(&latencyStats);
+    InitTask(TASK_LIMITER, "limiter", LimiterTask, 1, 0.0f);
+    InitTask(TASK_FRAME_STATE, "frame state", FrameStateTask, 1, 0.0f);
+    InitTask(TASK_FRAME_STATS, "frame stats", FrameStatsTask, 1, 0.0f);
+    InitTask(TASK_SIM_CONTEXT, "sim context", SimContextTask, 1, SIM_CONTEXT_POLL_INTERVAL);
+    InitTask(TASK_REMOTE_MAILBOX, "remote mailbox", RemoteMailboxTask, 1, 0.0f);
+    InitTask(TASK_SYNC_MASTER, "sync master", SyncMasterTask, 1, SYNC_HEARTBEAT_INTERVAL);
+    InitTask(TASK_SCREEN_BOUNDS, "screen bounds", ScreenBoundsTask, 1, SCREEN_BOUNDS_POLL_INTERVAL);
+    InitTask(TASK_LAYOUT, "layout", UpdateLayoutTask, 1, 0.0f);
+    InitTask(TASK_CONTROL_CINEMA_VERITE, "cinema verite", ControlCinemaVeriteTask, 1, CINEMA_VERITE_VIEW_POLL_INTERVAL);
+    InitTask(TASK_LOG, "log", FlushLogTask, 1, 0.0f);
+
+    // start listening for a local grading panel, if configured
+    if (remoteControlEnabled)
+        StartRemoteControl();
+
+    // join the grade sync group of a multi-PC visual system, if configured (a master sends from its task)
+    StartSync();
+
+    XPLMCreateFlightLoop_t schedulerFlightLoopParameters = {sizeof(XPLMCreateFlightLoop_t), xplm_FlightLoop_Phase_BeforeFlightModel, SchedulerFlightLoopCallback, NULL};
+    schedulerFlightLoop = XPLMCreateFlightLoop(&schedulerFlightLoopParameters);
+    SetTaskActive(TASK_FRAME_STATE, 1);
+    SetTaskActive(TASK_FRAME_STATS, 1);
+    FrameStateTask();   // so that callbacks before the first flight loop see a valid state
+    SetTaskActive(TASK_SCREEN_BOUNDS, 1);
+    SetTaskActive(TASK_LAYOUT, 1);
+    SetTaskActive(TASK_REMOTE_MAILBOX, remoteControlRunning.load() || syncRunning.load());
+    SetTaskActive(TASK_CONTROL_CINEMA_VERITE, NeedsCinemaVeriteTask());
+    SetTaskActive(TASK_LOG, 1);
+    UpdateSimContextActive();       // also starts watching the battery and temperatures of the host, if they have a cap
+    XPLMScheduleFlightLoop(schedulerFlightLoop, -1.0f, 1);
+
+    // create the one-shot timer of the cinema verite control and write its initial state
+    XPLMCreateFlightLoop_t cinemaVeriteTimerParameters = {sizeof(XPLMCreateFlightLoop_t), xplm_FlightLoop_Phase_BeforeFlightModel, CinemaVeriteTimerCallback, NULL};
+    cinemaVeriteTimerFlightLoop = XPLMCreateFlightLoop(&cinemaVeriteTimerParameters);
+    RefreshCinemaVerite();
 
     // register draw callbacks
     if (postProcesssingEnabled)
         XPLMRegisterDrawCallback(PostProcessingCallback, xplm_Phase_Window, 1, NULL);
-    if (fpsLimiterEnabled)
-        XPLMRegisterDrawCallback(LimiterDrawCallback, xplm_Phase_Terrain, 1, NULL);
+
+    // write the startup messages right away instead of with the first frame
+    FlushLogTask();
 
     return 1;
 }
@@ -1820,22 +5064,57 @@ PLUGIN_API void XPluginStop(void)
     SaveSettings();
     
     CleanupShader(1);
-
-    // unregister own DataRef
+    ReleaseFrameFences();
+    if (settingsWindow != NULL)
+        XPLMDestroyWindow(settingsWindow);
+    settingsWindow = NULL;
+    if (uiFontTexture != 0)
+        glDeleteTextures(1, (GLuint *) &uiFontTexture);
+    uiFontTexture = 0;
+    ReleasePresetThumbnails();
+    SetHudEnabled(0);
+    ReleaseLatencyProbes();
+
+    StopRemoteControl();
+    StopSync();
+    StopPowerMonitor();
+
+    // unregister own DataRefs
     XPLMUnregisterDataAccessor(overrideControlCinemaVeriteDataRef);
-
-    // unregister flight loop callbacks
-    XPLMUnregisterFlightLoopCallback(UpdateFakeWindowCallback, NULL);
-    if (fpsLimiterEnabled)
-        XPLMUnregisterFlightLoopCallback(LimiterFlightCallback, NULL);
-    if (controlCinemaVeriteEnabled)
-        XPLMUnregisterFlightLoopCallback(ControlCinemaVeriteCallback, NULL);
+    for (int i = 0; i < PARAM_MAX; i++)
+        XPLMUnregisterDataAccessor(paramDataRefs[i]);
+    XPLMUnregisterDataAccessor(paramsDataRef);
+    for (int i = 0; i < STAT_MAX; i++)
+        XPLMUnregisterDataAccessor(statsDataRefs[i]);
+    XPLMUnregisterDataAccessor(fpsCapDataRef);
+    XPLMUnregisterDataAccessor(gpuWaitDataRef);
+    XPLMUnregisterDataAccessor(taskTimesDataRef);
+    XPLMUnregisterDataAccessor(xplmCallsDataRef);
+    for (int i = STAT_FRAME_TIME_P50; i <= STAT_FRAME_TIME_P99; i++)
+        XPLMUnregisterDataAccessor(latencyDataRefs[i]);
+
+    // destroy the transition flight loop
+    XPLMDestroyFlightLoop(parameterFlightLoop);
+    parameterFlightLoop = NULL;
+
+    // destroy the scheduler flight loop
+    if (limiterActive)
+        SetLimiterActive(0);
+    XPLMDestroyFlightLoop(schedulerFlightLoop);
+    schedulerFlightLoop = NULL;
+    XPLMDestroyFlightLoop(cinemaVeriteTimerFlightLoop);
+    cinemaVeriteTimerFlightLoop = NULL;
+    LogFrameStats(&frameStats);
+    LogTaskStatistics();
+    if (sliderEvents > 0)
+        LogFormat(&logQueue, LOG_INFO, NAME_VERSION": Settings window: %ld slider events, %.1f widget calls per event on average.\n", sliderEvents, (double) sliderEventWidgetCalls / sliderEvents);
 
     // unregister draw callbacks
     if (postProcesssingEnabled)
         XPLMUnregisterDrawCallback(PostProcessingCallback, xplm_Phase_Window, 1, NULL);
-    if (fpsLimiterEnabled)
-        XPLMUnregisterDrawCallback(LimiterDrawCallback, xplm_Phase_Terrain, 1, NULL);
+
+    // write what is left in the log queue (the background threads are stopped by now)
+    FlushLogTask();
 }
 
 PLUGIN_API void XPluginDisable(void)
@@ -1845,13 +5124,20 @@ PLUGIN_API void XPluginDisable(void)
 
 PLUGIN_API int XPluginEnable(void)
 {
+    // datarefs of other plugins may have gone away or come back while disabled (e.g. plugins reloaded)
+    ResolveDataRefs(0);
+
     return 1;
 }
 
 PLUGIN_API void XPluginReceiveMessage(XPLMPluginID inFromWho, long inMessage, void *inParam)
 {
     if (inMessage == XPLM_MSG_PLANE_LOADED)
+    {
         bringFakeWindowToFront = 0;
+        layoutStale = 1;
+        ResolveDataRefs(0);     // aircraft plugins have been (re)loaded
+    }
     else if (inMessage == XPLM_MSG_SCENERY_LOADED)
         UpdateRaleighScale(0);
 }
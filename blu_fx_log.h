@@ -0,0 +1,173 @@
+/* Copyright (C) 2024  Steve Goldberg
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// log queue of the plugin: any thread (including the background threads, which must not call XPLMDebugString) writes
+// formatted records into a bounded lock-free queue with many producers and one consumer, the sim thread takes them
+// out once per frame and writes them to Log.txt in one call; records below the log level are not even formatted, and
+// messages that don't fit into a full queue are dropped as a whole and counted; kept free of XPLM calls like
+// blu_fx_pacer.h
+
+#ifndef BLU_FX_LOG_H
+#define BLU_FX_LOG_H
+
+#include <algorithm>
+#include <atomic>
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define LOG_QUEUE_SIZE 256              /* records, a power of two */
+#define LOG_RECORD_SIZE 256             /* bytes per record including the terminator, longer texts take several */
+#define LOG_FORMAT_SIZE 1024            /* bytes of a formatted message (LogFormat), longer ones are cut */
+
+// records a message takes at most, enough for a formatted one, the rest of a longer text is cut
+#define LOG_MESSAGE_RECORDS ((LOG_FORMAT_SIZE + LOG_RECORD_SIZE - 2) / (LOG_RECORD_SIZE - 1))
+
+// levels of the log records, a log level lets the records of that level and above through
+enum BLUfxLogLevels_t
+{
+    LOG_DEBUG,
+    LOG_INFO,
+    LOG_WARNING,
+    LOG_ERROR
+};
+
+// slot of the log queue: sequence tells whether it is free for the producer at that position (sequence = position)
+// or holds the record for the consumer at that position (sequence = position + 1)
+struct BLUfxLogRecord_t
+{
+    std::atomic<uint32_t> sequence;
+    char text[LOG_RECORD_SIZE];
+};
+typedef BLUfxLogRecord_t BLUfxLogRecord;
+
+// bounded MPSC queue of log records (after D. Vyukov's bounded queue), producers claim the positions of a message with
+// one CAS, so that its records stay together
+struct BLUfxLog_t
+{
+    BLUfxLogRecord records[LOG_QUEUE_SIZE];
+    std::atomic<uint32_t> enqueuePosition;
+    uint32_t dequeuePosition;           // only used by the consumer
+    std::atomic<int> level;
+    std::atomic<uint32_t> dropped;      // messages since the last drain
+};
+typedef BLUfxLog_t BLUfxLog;
+
+// resets a log queue (while no other thread uses it)
+static void InitLog(BLUfxLog *log, int level)
+{
+    for (uint32_t i = 0; i < LOG_QUEUE_SIZE; i++)
+        log->records[i].sequence.store(i, std::memory_order_relaxed);
+    log->enqueuePosition.store(0, std::memory_order_relaxed);
+    log->dequeuePosition = 0;
+    log->level.store(level, std::memory_order_relaxed);
+    log->dropped.store(0, std::memory_order_release);
+}
+
+// returns whether records of the given level are written
+static inline bool LogEnabled(const BLUfxLog *log, int level)
+{
+    return level >= log->level.load(std::memory_order_relaxed);
+}
+
+// adds a text of up to LOG_MESSAGE_RECORDS records in consecutive positions, so that records of other threads can't
+// come between them; returns false (and counts the message) if the queue has no room for all of them
+static bool LogPushRecords(BLUfxLog *log, const char *text, size_t length)
+{
+    uint32_t count = (uint32_t) std::max((size_t) 1, (length + LOG_RECORD_SIZE - 2) / (LOG_RECORD_SIZE - 1));
+    uint32_t position = log->enqueuePosition.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        // all slots of the message must be free in this lap, one still holding a record means the queue is full
+        int32_t difference = 0;
+        for (uint32_t i = 0; i < count && difference == 0; i++)
+            difference = (int32_t) (log->records[(position + i) % LOG_QUEUE_SIZE].sequence.load(std::memory_order_acquire) - (position + i));
+        if (difference == 0 && log->enqueuePosition.compare_exchange_weak(position, position + count, std::memory_order_relaxed))
+            break;
+        else if (difference < 0)
+        {
+            log->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else if (difference > 0)
+            position = log->enqueuePosition.load(std::memory_order_relaxed);
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        BLUfxLogRecord *record = &log->records[(position + i) % LOG_QUEUE_SIZE];
+        size_t part = std::min(length, (size_t) (LOG_RECORD_SIZE - 1));
+        memcpy(record->text, text, part);
+        record->text[part] = '\0';
+        record->sequence.store(position + i + 1, std::memory_order_release);
+        text += part;
+        length -= part;
+    }
+    return true;
+}
+
+// writes a text of the given level, split into as many records as needed and cut after LOG_MESSAGE_RECORDS of them
+// (callable from any thread)
+static void LogWrite(BLUfxLog *log, int level, const char *text)
+{
+    if (!LogEnabled(log, level))
+        return;
+
+    LogPushRecords(log, text, std::min(strlen(text), (size_t) LOG_MESSAGE_RECORDS * (LOG_RECORD_SIZE - 1)));
+}
+
+// writes a printf-style message of the given level (callable from any thread)
+static void LogFormat(BLUfxLog *log, int level, const char *format, ...)
+{
+    if (!LogEnabled(log, level))
+        return;
+
+    char text[LOG_FORMAT_SIZE];
+    va_list arguments;
+    va_start(arguments, format);
+    vsnprintf(text, sizeof(text), format, arguments);
+    va_end(arguments);
+    LogWrite(log, level, text);
+}
+
+// takes the records out of the queue (consumer only), at most LOG_QUEUE_SIZE of them so that producers refilling it
+// meanwhile can't overrun the batch, and appends them to batch, which has room for at least LOG_QUEUE_SIZE *
+// LOG_RECORD_SIZE bytes; returns the length of the batch and the number of dropped messages
+static size_t DrainLog(BLUfxLog *log, char *batch, uint32_t *dropped)
+{
+    size_t length = 0;
+    for (int i = 0; i < LOG_QUEUE_SIZE; i++)
+    {
+        BLUfxLogRecord *record = &log->records[log->dequeuePosition % LOG_QUEUE_SIZE];
+        if (record->sequence.load(std::memory_order_acquire) != log->dequeuePosition + 1)
+            break;
+
+        size_t recordLength = strlen(record->text);
+        memcpy(batch + length, record->text, recordLength);
+        length += recordLength;
+        record->sequence.store(log->dequeuePosition + LOG_QUEUE_SIZE, std::memory_order_release);
+        log->dequeuePosition++;
+    }
+    batch[length] = '\0';
+    *dropped = log->dropped.exchange(0, std::memory_order_relaxed);
+
+    return length;
+}
+
+#endif
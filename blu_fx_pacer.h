@@ -0,0 +1,175 @@
+/* Copyright (C) 2024  Steve Goldberg
+ *
+ * Original version:
+ * Copyright (C) 2018  Matteo Hausner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// frame pacer of the FPS-Limiter, kept free of XPLM calls so that it can also be driven by the standalone bench in
+// tools/blu_fx_pacer_bench.cpp (with a simulated clock, or the system clock as in the plugin)
+
+#ifndef BLU_FX_PACER_H
+#define BLU_FX_PACER_H
+
+#include <algorithm>
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#if IBM
+#include <windows.h>
+#elif APL
+#include <mach/mach_time.h>
+#endif
+
+// clock used by a pacer: a monotonic timestamp in seconds and a sleep until such a timestamp
+struct BLUfxClock_t
+{
+    double (*now)(void);
+    void (*sleepUntil)(double time);
+};
+typedef BLUfxClock_t BLUfxClock;
+
+// state of a frame pacer, which waits for an absolute deadline that advances by exactly one period per frame, so
+// that scheduler overshoot in one frame is made up in the next one instead of accumulating
+struct BLUfxPacer_t
+{
+    const BLUfxClock *clock;
+    double deadline;            // end of the current frame (0 = not started)
+    double spinMargin;          // last part of each wait that is spun instead of slept, calibrated from the oversleep
+    double lastWakeTime;        // end of the previous wait, if the pacer had to wait in the previous frame (else 0)
+    // jitter statistics: deviation of the paced frame periods from the target period
+    long pacedFrames;
+    double deviationSum, deviationSquareSum, deviationMax;
+};
+typedef BLUfxPacer_t BLUfxPacer;
+
+#define PACER_MIN_SPIN_MARGIN 0.0001
+#define PACER_MAX_SPIN_MARGIN 0.002
+#define PACER_INITIAL_SPIN_MARGIN 0.0003
+
+// returns a monotonic timestamp in seconds (unlike XPLMGetElapsedTime, precise enough for frame pacing)
+static double GetMonotonicTime(void)
+{
+#if IBM
+    static LARGE_INTEGER frequency = {0};
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+#elif APL
+    static mach_timebase_info_data_t timebase = {0, 0};
+    if (timebase.denom == 0)
+        mach_timebase_info(&timebase);
+    return (double) mach_absolute_time() * timebase.numer / timebase.denom * 1.0e-9;
+#else
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1.0e-9;
+#endif
+}
+
+// sleeps until shortly before the given monotonic time (the remainder is spun, see PacerWaitUntil)
+static void SleepUntil(double time)
+{
+#if IBM
+    double remaining = time - GetMonotonicTime();
+    if (remaining > 0.001)
+        Sleep((DWORD) ((remaining - 0.001) * 1000.0));  // timer resolution is 1 ms while the limiter is on
+#elif APL
+    static mach_timebase_info_data_t timebase = {0, 0};
+    if (timebase.denom == 0)
+        mach_timebase_info(&timebase);
+    mach_wait_until((uint64_t) (time * 1.0e9 * timebase.denom / timebase.numer));
+#else
+    timespec deadline;
+    deadline.tv_sec = (time_t) time;
+    deadline.tv_nsec = (long) ((time - (double) deadline.tv_sec) * 1.0e9);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+        ;
+#endif
+}
+
+// the clock of the plugin
+static const BLUfxClock BLUfxSystemClock = {GetMonotonicTime, SleepUntil};
+
+// resets a pacer, e.g. when the limiter is switched on
+static void ResetPacer(BLUfxPacer *pacer, const BLUfxClock *clock = &BLUfxSystemClock)
+{
+    memset(pacer, 0, sizeof(*pacer));
+    pacer->clock = clock;
+    pacer->spinMargin = PACER_INITIAL_SPIN_MARGIN;
+}
+
+// waits until the deadline of the current frame, sleeping for the bulk of the time and spinning for the rest
+static void PacerWaitUntil(BLUfxPacer *pacer, double deadline)
+{
+    double wakeTime = deadline - pacer->spinMargin;
+    if (pacer->clock->now() < wakeTime)
+    {
+        pacer->clock->sleepUntil(wakeTime);
+
+        // calibrate the spin margin to twice the recent scheduler oversleep
+        double oversleep = std::max(0.0, pacer->clock->now() - wakeTime);
+        pacer->spinMargin = std::min(std::max(PACER_MIN_SPIN_MARGIN, 0.9 * pacer->spinMargin + 0.1 * 2.0 * oversleep), PACER_MAX_SPIN_MARGIN);
+    }
+
+    while (pacer->clock->now() < deadline)
+        ;
+}
+
+// lets the thread sleep to achieve the given frame rate, called once at the end of each frame
+static void LimitFps(BLUfxPacer *pacer, float fps)
+{
+    double period = 1.0 / fps;
+    double now = pacer->clock->now();
+    double deadline = pacer->deadline + period;
+
+    // start the schedule over on the first frame and after a long frame (no point in catching up for more than a period)
+    if (pacer->deadline == 0.0 || now > deadline + period)
+    {
+        pacer->deadline = now;
+        pacer->lastWakeTime = 0.0;
+        return;
+    }
+
+    pacer->deadline = deadline;
+
+    if (now >= deadline)
+    {
+        pacer->lastWakeTime = 0.0;    // frame took longer than the period, nothing to pace
+        return;
+    }
+
+    PacerWaitUntil(pacer, deadline);
+
+    double wakeTime = pacer->clock->now();
+    if (pacer->lastWakeTime != 0.0)
+    {
+        double deviation = fabs((wakeTime - pacer->lastWakeTime) - period);
+        pacer->pacedFrames++;
+        pacer->deviationSum += deviation;
+        pacer->deviationSquareSum += deviation * deviation;
+        pacer->deviationMax = std::max(pacer->deviationMax, deviation);
+    }
+    pacer->lastWakeTime = wakeTime;
+}
+
+#endif
@@ -0,0 +1,348 @@
+/* Copyright (C) 2024  Steve Goldberg
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// parameter messages of the remote control and the grade sync: the receiving thread and the lock-free mailbox it posts
+// to, and the sending side of a sync master, kept free of XPLM calls like blu_fx_pacer.h, so that
+// tools/blu_fx_remote_test.cpp can run them on loopback
+
+#ifndef BLU_FX_REMOTE_H
+#define BLU_FX_REMOTE_H
+
+#include "blu_fx_log.h"
+
+#include <atomic>
+#include <chrono>
+
+#include <stdint.h>
+#include <string.h>
+
+#if IBM
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+// socket portability
+#if IBM
+typedef SOCKET BLUfxSocket;
+#define INVALID_BLUFX_SOCKET INVALID_SOCKET
+#define CloseSocket closesocket
+#else
+typedef int BLUfxSocket;
+#define INVALID_BLUFX_SOCKET (-1)
+#define CloseSocket close
+#endif
+
+// remote control messages, as sent by a grading panel on the same machine to the remote control port on 127.0.0.1:
+// magic "BLFX", 32-bit sequence number, 32-bit mask of the parameters that follow (bit i = BLUfxParams_t i) and one
+// 32-bit float per set bit in ascending order, all little-endian
+#define REMOTE_MESSAGE_MAGIC "BLFX"
+#define REMOTE_MESSAGE_HEADER_SIZE 12
+#define REMOTE_MAX_PARAMS 32            /* bits of the mask */
+#define REMOTE_MESSAGE_MAX_SIZE (REMOTE_MESSAGE_HEADER_SIZE + REMOTE_MAX_PARAMS * 4)
+#define REMOTE_SEQUENCE_WINDOW 1024     /* older sequence numbers within this window are dropped as stale */
+
+// multi-instance synchronisation: the master multicasts its parameter changes to the followers using the same messages,
+// containing only the parameters that changed (deltas); when idle it sends a heartbeat (no parameters) every
+// SYNC_HEARTBEAT_INTERVAL seconds, and every SYNC_KEYFRAME_HEARTBEATS-th heartbeat carries all parameters, so that
+// followers that joined late or lost a packet catch up; the sequence numbers of a master start at the wall-clock time
+// in ms, so that a restarted master is ahead of its last run (it sends at most one message per frame) and its followers
+// don't drop its messages as stale
+#define SYNC_HEARTBEAT_INTERVAL 1.0f
+#define SYNC_KEYFRAME_HEARTBEATS 10
+
+// lock-free mailbox between a receiving thread (producer) and the sim thread (consumer): a producer stores the latest
+// value of a parameter before setting its bit, the consumer takes all bits at once and then reads the values
+struct BLUfxRemoteMailbox_t
+{
+    std::atomic<float> values[REMOTE_MAX_PARAMS];
+    std::atomic<unsigned int> mask;
+};
+typedef BLUfxRemoteMailbox_t BLUfxRemoteMailbox;
+
+// state of a receiving thread
+struct BLUfxParamReceiver_t
+{
+    BLUfxRemoteMailbox *mailbox;
+    int paramCount;                     // values of the bits beyond (from a newer sender) are skipped
+    uint32_t lastSequence;
+    bool hasSequence;
+    BLUfxLog *log;                      // NULL = no logging
+    const char *logPrefix;
+};
+typedef BLUfxParamReceiver_t BLUfxParamReceiver;
+
+// state of a sync master
+struct BLUfxSyncMaster_t
+{
+    float lastSent[REMOTE_MAX_PARAMS];
+    int paramCount;
+    uint32_t sequence;                  // of the last message
+    float idleTime;                     // s since the last message
+    int heartbeats;
+};
+typedef BLUfxSyncMaster_t BLUfxSyncMaster;
+
+// resets a receiver before its thread is started
+static void ResetParamReceiver(BLUfxParamReceiver *receiver, BLUfxRemoteMailbox *mailbox, int paramCount, BLUfxLog *log, const char *logPrefix)
+{
+    receiver->mailbox = mailbox;
+    receiver->paramCount = paramCount;
+    receiver->lastSequence = 0;
+    receiver->hasSequence = false;
+    receiver->log = log;
+    receiver->logPrefix = logPrefix;
+}
+
+// builds a parameter message (see REMOTE_MESSAGE_MAGIC) from the masked values, returns its length
+static int BuildParamMessage(unsigned char *buffer, uint32_t sequence, unsigned int mask, const float *values)
+{
+    memcpy(buffer, REMOTE_MESSAGE_MAGIC, 4);
+    memcpy(buffer + 4, &sequence, 4);
+    memcpy(buffer + 8, &mask, 4);
+
+    int length = REMOTE_MESSAGE_HEADER_SIZE;
+    for (int i = 0; i < REMOTE_MAX_PARAMS; i++)
+    {
+        if (mask & (1u << i))
+        {
+            memcpy(buffer + length, &values[i], 4);
+            length += 4;
+        }
+    }
+
+    return length;
+}
+
+// checks a received message and posts its values to the mailbox, returns false if it was dropped
+static bool AcceptParamMessage(BLUfxParamReceiver *receiver, const unsigned char *buffer, int length)
+{
+    if (length < REMOTE_MESSAGE_HEADER_SIZE || memcmp(buffer, REMOTE_MESSAGE_MAGIC, 4) != 0)
+        return false;   // error or not one of ours
+
+    uint32_t sequence, mask;
+    memcpy(&sequence, buffer + 4, 4);
+    memcpy(&mask, buffer + 8, 4);
+
+    // drop duplicates and late arrivals, a big jump backwards means the sender was restarted
+    int32_t age = (int32_t) (sequence - receiver->lastSequence);
+    if (receiver->hasSequence && age <= 0 && age > -REMOTE_SEQUENCE_WINDOW)
+        return false;
+    if (receiver->hasSequence && age <= 0 && receiver->log != NULL)
+        LogFormat(receiver->log, LOG_DEBUG, "%sParameter sender restarted (sequence %u after %u).\n", receiver->logPrefix, sequence, receiver->lastSequence);
+
+    int count = 0;
+    for (int i = 0; i < REMOTE_MAX_PARAMS; i++)
+        count += (mask >> i) & 1;
+    if (length != REMOTE_MESSAGE_HEADER_SIZE + count * 4)
+        return false;
+
+    const unsigned char *value = buffer + REMOTE_MESSAGE_HEADER_SIZE;
+    for (int i = 0; i < REMOTE_MAX_PARAMS; i++)
+    {
+        if (mask & (1u << i))
+        {
+            float f;
+            memcpy(&f, value, 4);
+            if (i < receiver->paramCount)
+                receiver->mailbox->values[i].store(f, std::memory_order_relaxed);
+            value += 4;
+        }
+    }
+    if (receiver->paramCount < REMOTE_MAX_PARAMS)
+        mask &= (1u << receiver->paramCount) - 1;
+    if (mask != 0)
+        receiver->mailbox->mask.fetch_or(mask, std::memory_order_release);
+
+    receiver->lastSequence = sequence;
+    receiver->hasSequence = true;
+    return true;
+}
+
+// background thread that receives parameter messages on the given socket and posts them to the mailbox, used for
+// both remote control and sync followers (no XPLM calls in here!)
+static void ReceiveParamMessages(BLUfxSocket receiveSocket, BLUfxParamReceiver *receiver, std::atomic<bool> *running)
+{
+    unsigned char buffer[REMOTE_MESSAGE_MAX_SIZE + 1];     // one extra byte to detect oversized messages
+
+    while (running->load())
+    {
+        int length = (int) recv(receiveSocket, (char *) buffer, sizeof(buffer), 0);
+        if (length > 0)
+            AcceptParamMessage(receiver, buffer, length);   // else a receive timeout, to check the running flag
+    }
+}
+
+// returns the sequence number a sync master starts at (see SYNC_HEARTBEAT_INTERVAL)
+static uint32_t SyncSequenceSeed(void)
+{
+    return (uint32_t) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// resets a sync master to the current values, its first message will be a keyframe
+static void ResetSyncMaster(BLUfxSyncMaster *master, const float *values, int paramCount, uint32_t firstSequence)
+{
+    memcpy(master->lastSent, values, paramCount * sizeof(float));
+    master->paramCount = paramCount;
+    master->sequence = firstSequence - 1;
+    master->idleTime = SYNC_HEARTBEAT_INTERVAL;
+    master->heartbeats = SYNC_KEYFRAME_HEARTBEATS - 1;
+}
+
+// builds the message a sync master sends now (the changed parameters, or a heartbeat when idle for long enough, with
+// elapsed the seconds since the last call), returns its length or 0 if nothing is due
+static int SyncMasterMessage(BLUfxSyncMaster *master, const float *values, float elapsed, unsigned char *buffer)
+{
+    unsigned int mask = 0;
+    for (int i = 0; i < master->paramCount; i++)
+    {
+        if (values[i] != master->lastSent[i])
+            mask |= 1u << i;
+    }
+
+    if (mask == 0)
+    {
+        master->idleTime += elapsed;
+        if (master->idleTime < SYNC_HEARTBEAT_INTERVAL)
+            return 0;
+
+        // heartbeat, every so often with all parameters as a keyframe
+        if (++master->heartbeats % SYNC_KEYFRAME_HEARTBEATS == 0)
+            mask = (master->paramCount < REMOTE_MAX_PARAMS ? (1u << master->paramCount) - 1 : ~0u);
+    }
+
+    memcpy(master->lastSent, values, master->paramCount * sizeof(float));
+    master->idleTime = 0.0f;
+
+    return BuildParamMessage(buffer, ++master->sequence, mask, values);
+}
+
+// takes all parameters posted since the last call (consumer only), returns their mask and stores their values
+static unsigned int TakeRemoteMailbox(BLUfxRemoteMailbox *mailbox, float *values)
+{
+    if (mailbox->mask.load(std::memory_order_relaxed) == 0)
+        return 0;
+
+    unsigned int mask = mailbox->mask.exchange(0, std::memory_order_acquire);
+    for (int i = 0; i < REMOTE_MAX_PARAMS; i++)
+    {
+        if (mask & (1u << i))
+            values[i] = mailbox->values[i].load(std::memory_order_relaxed);
+    }
+
+    return mask;
+}
+
+// makes recv() on the socket wake up regularly, so that a receiving thread notices when it is stopped
+static void SetReceiveTimeout(BLUfxSocket receiveSocket)
+{
+#if IBM
+    DWORD timeout = 250;
+#else
+    timeval timeout = {0, 250000};
+#endif
+    setsockopt(receiveSocket, SOL_SOCKET, SO_RCVTIMEO, (const char *) &timeout, sizeof(timeout));
+}
+
+// opens a receiving socket on the given port of the loopback interface (0 = any free port), returns
+// INVALID_BLUFX_SOCKET if that fails
+static BLUfxSocket OpenRemoteControlSocket(int port)
+{
+    BLUfxSocket receiveSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((unsigned short) port);
+
+    if (receiveSocket == INVALID_BLUFX_SOCKET || bind(receiveSocket, (sockaddr *) &address, sizeof(address)) != 0)
+    {
+        if (receiveSocket != INVALID_BLUFX_SOCKET)
+            CloseSocket(receiveSocket);
+        return INVALID_BLUFX_SOCKET;
+    }
+
+    SetReceiveTimeout(receiveSocket);
+    return receiveSocket;
+}
+
+// opens a socket on the sync multicast group: for a master one that sends to the group (with a TTL of 1 to stay on the
+// local network, and looped back so followers on this machine work too), for a follower one that receives from the
+// group on the given port (0 = any free port), returns INVALID_BLUFX_SOCKET if that fails
+static BLUfxSocket OpenSyncSocket(const char *group, int port, bool master)
+{
+    BLUfxSocket syncSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+    ip_mreq membership;
+    membership.imr_multiaddr.s_addr = inet_addr(group);
+    membership.imr_interface.s_addr = htonl(INADDR_ANY);
+
+    bool success = (syncSocket != INVALID_BLUFX_SOCKET && IN_MULTICAST(ntohl(membership.imr_multiaddr.s_addr)));
+
+    if (success && master)
+    {
+        unsigned char ttl = 1, loop = 1;
+        setsockopt(syncSocket, IPPROTO_IP, IP_MULTICAST_TTL, (const char *) &ttl, sizeof(ttl));
+        setsockopt(syncSocket, IPPROTO_IP, IP_MULTICAST_LOOP, (const char *) &loop, sizeof(loop));
+    }
+    else if (success)
+    {
+        // several followers may run on one machine (e.g., for testing)
+        int reuse = 1;
+        setsockopt(syncSocket, SOL_SOCKET, SO_REUSEADDR, (const char *) &reuse, sizeof(reuse));
+#ifdef SO_REUSEPORT
+        setsockopt(syncSocket, SOL_SOCKET, SO_REUSEPORT, (const char *) &reuse, sizeof(reuse));
+#endif
+
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons((unsigned short) port);
+
+        success = (bind(syncSocket, (sockaddr *) &address, sizeof(address)) == 0 && setsockopt(syncSocket, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char *) &membership, sizeof(membership)) == 0);
+        if (success)
+            SetReceiveTimeout(syncSocket);
+    }
+
+    if (!success && syncSocket != INVALID_BLUFX_SOCKET)
+    {
+        CloseSocket(syncSocket);
+        syncSocket = INVALID_BLUFX_SOCKET;
+    }
+
+    return syncSocket;
+}
+
+// sends a message of a sync master to the group
+static void SendSyncMessage(BLUfxSocket syncSocket, const char *group, int port, const unsigned char *buffer, int length)
+{
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = inet_addr(group);
+    address.sin_port = htons((unsigned short) port);
+    sendto(syncSocket, (const char *) buffer, length, 0, (sockaddr *) &address, sizeof(address));
+}
+
+#endif
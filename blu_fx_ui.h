@@ -0,0 +1,477 @@
+/* Copyright (C) 2024  Steve Goldberg
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// immediate-mode UI of the settings window: each frame the whole window is described again by calling the functions
+// below (which return whether the user changed something), so there is no widget tree to keep in sync with the
+// settings; everything goes into one vertex list with a single texture (the font atlas, which also has a solid cell
+// for plain rectangles), which the plugin draws with one draw call; images (the preset thumbnails) go into a second
+// list that is drawn on top with the image texture; kept free of XPLM and GL calls like blu_fx_pacer.h
+
+#ifndef BLU_FX_UI_H
+#define BLU_FX_UI_H
+
+#include <algorithm>
+#include <vector>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// built-in 5x7 pixel font for ASCII 32 to 126 (bit 4 is the leftmost pixel of a row, the first row is the top one),
+// drawn at UI_SCALE boxels per pixel
+#define UI_FONT_FIRST 32
+#define UI_FONT_GLYPHS 95
+#define UI_GLYPH_WIDTH 5
+#define UI_GLYPH_HEIGHT 7
+#define UI_SCALE 2
+#define UI_CHAR_ADVANCE ((UI_GLYPH_WIDTH + 1) * UI_SCALE)
+#define UI_TEXT_HEIGHT (UI_GLYPH_HEIGHT * UI_SCALE)
+
+// font atlas: one UI_ATLAS_CELL texel cell per glyph, in rows of UI_ATLAS_COLUMNS, followed by the solid cell
+#define UI_ATLAS_CELL 8
+#define UI_ATLAS_COLUMNS 16
+#define UI_ATLAS_WIDTH (UI_ATLAS_COLUMNS * UI_ATLAS_CELL)
+#define UI_ATLAS_HEIGHT (((UI_FONT_GLYPHS + 1 + UI_ATLAS_COLUMNS - 1) / UI_ATLAS_COLUMNS) * UI_ATLAS_CELL)
+#define UI_SOLID_CELL UI_FONT_GLYPHS
+
+// layout, in boxels
+#define UI_PADDING 10
+#define UI_ROW_HEIGHT 22
+#define UI_ITEM_HEIGHT 18
+
+#define UI_RGBA(r, g, b, a) ((unsigned int) (r) | ((unsigned int) (g) << 8) | ((unsigned int) (b) << 16) | ((unsigned int) (a) << 24))
+#define UI_COLOR_TEXT UI_RGBA(230, 230, 230, 255)
+#define UI_COLOR_TEXT_DISABLED UI_RGBA(130, 130, 130, 255)
+#define UI_COLOR_HEADER UI_RGBA(150, 200, 255, 255)
+#define UI_COLOR_BACKGROUND UI_RGBA(25, 28, 34, 235)
+#define UI_COLOR_ITEM UI_RGBA(60, 66, 78, 255)
+#define UI_COLOR_ITEM_HOT UI_RGBA(80, 88, 104, 255)
+#define UI_COLOR_ITEM_ACTIVE UI_RGBA(70, 120, 190, 255)
+#define UI_COLOR_TRACK UI_RGBA(45, 50, 60, 255)
+#define UI_COLOR_LINE UI_RGBA(90, 96, 110, 255)
+#define UI_COLOR_FIELD UI_RGBA(15, 17, 21, 255)
+
+// keys typed into the focused text field, besides the printable characters
+#define UI_KEY_BACKSPACE '\b'
+#define UI_KEY_RETURN '\r'
+#define UI_KEY_ESCAPE '\x1b'
+#define UI_MAX_KEYS 16                  /* per frame, more are dropped */
+
+static const unsigned char BLUfxUiFont[UI_FONT_GLYPHS][UI_GLYPH_HEIGHT] =
+{
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // ' '
+    {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04},   // '!'
+    {0x0a, 0x0a, 0x0a, 0x00, 0x00, 0x00, 0x00},   // '"'
+    {0x0a, 0x0a, 0x1f, 0x0a, 0x1f, 0x0a, 0x0a},   // '#'
+    {0x04, 0x0f, 0x14, 0x0e, 0x05, 0x1e, 0x04},   // '$'
+    {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03},   // '%'
+    {0x0c, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0d},   // '&'
+    {0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00},   // '\''
+    {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02},   // '('
+    {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08},   // ')'
+    {0x00, 0x04, 0x15, 0x0e, 0x15, 0x04, 0x00},   // '*'
+    {0x00, 0x04, 0x04, 0x1f, 0x04, 0x04, 0x00},   // '+'
+    {0x00, 0x00, 0x00, 0x00, 0x0c, 0x04, 0x08},   // ','
+    {0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00},   // '-'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c},   // '.'
+    {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00},   // '/'
+    {0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e},   // '0'
+    {0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e},   // '1'
+    {0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f},   // '2'
+    {0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e},   // '3'
+    {0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02},   // '4'
+    {0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e},   // '5'
+    {0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e},   // '6'
+    {0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08},   // '7'
+    {0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e},   // '8'
+    {0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c},   // '9'
+    {0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00},   // ':'
+    {0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x04, 0x08},   // ';'
+    {0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02},   // '<'
+    {0x00, 0x00, 0x1f, 0x00, 0x1f, 0x00, 0x00},   // '='
+    {0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08},   // '>'
+    {0x0e, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04},   // '?'
+    {0x0e, 0x11, 0x01, 0x0d, 0x15, 0x15, 0x0e},   // '@'
+    {0x0e, 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11},   // 'A'
+    {0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e},   // 'B'
+    {0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e},   // 'C'
+    {0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c},   // 'D'
+    {0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f},   // 'E'
+    {0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10},   // 'F'
+    {0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f},   // 'G'
+    {0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11},   // 'H'
+    {0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e},   // 'I'
+    {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c},   // 'J'
+    {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11},   // 'K'
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f},   // 'L'
+    {0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11},   // 'M'
+    {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11},   // 'N'
+    {0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e},   // 'O'
+    {0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10},   // 'P'
+    {0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d},   // 'Q'
+    {0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11},   // 'R'
+    {0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e},   // 'S'
+    {0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04},   // 'T'
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e},   // 'U'
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04},   // 'V'
+    {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a},   // 'W'
+    {0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11},   // 'X'
+    {0x11, 0x11, 0x11, 0x0a, 0x04, 0x04, 0x04},   // 'Y'
+    {0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f},   // 'Z'
+    {0x0e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0e},   // '['
+    {0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00},   // '\\'
+    {0x0e, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0e},   // ']'
+    {0x04, 0x0a, 0x11, 0x00, 0x00, 0x00, 0x00},   // '^'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f},   // '_'
+    {0x08, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00},   // '`'
+    {0x00, 0x00, 0x0e, 0x01, 0x0f, 0x11, 0x0f},   // 'a'
+    {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1e},   // 'b'
+    {0x00, 0x00, 0x0e, 0x10, 0x10, 0x11, 0x0e},   // 'c'
+    {0x01, 0x01, 0x0d, 0x13, 0x11, 0x11, 0x0f},   // 'd'
+    {0x00, 0x00, 0x0e, 0x11, 0x1f, 0x10, 0x0e},   // 'e'
+    {0x06, 0x09, 0x08, 0x1c, 0x08, 0x08, 0x08},   // 'f'
+    {0x00, 0x0f, 0x11, 0x11, 0x0f, 0x01, 0x0e},   // 'g'
+    {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11},   // 'h'
+    {0x04, 0x00, 0x0c, 0x04, 0x04, 0x04, 0x0e},   // 'i'
+    {0x02, 0x00, 0x06, 0x02, 0x02, 0x12, 0x0c},   // 'j'
+    {0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12},   // 'k'
+    {0x0c, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e},   // 'l'
+    {0x00, 0x00, 0x1a, 0x15, 0x15, 0x11, 0x11},   // 'm'
+    {0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11},   // 'n'
+    {0x00, 0x00, 0x0e, 0x11, 0x11, 0x11, 0x0e},   // 'o'
+    {0x00, 0x00, 0x1e, 0x11, 0x1e, 0x10, 0x10},   // 'p'
+    {0x00, 0x00, 0x0d, 0x13, 0x0f, 0x01, 0x01},   // 'q'
+    {0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10},   // 'r'
+    {0x00, 0x00, 0x0e, 0x10, 0x0e, 0x01, 0x1e},   // 's'
+    {0x08, 0x08, 0x1c, 0x08, 0x08, 0x09, 0x06},   // 't'
+    {0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0d},   // 'u'
+    {0x00, 0x00, 0x11, 0x11, 0x11, 0x0a, 0x04},   // 'v'
+    {0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0a},   // 'w'
+    {0x00, 0x00, 0x11, 0x0a, 0x04, 0x0a, 0x11},   // 'x'
+    {0x00, 0x00, 0x11, 0x11, 0x0f, 0x01, 0x0e},   // 'y'
+    {0x00, 0x00, 0x1f, 0x02, 0x04, 0x08, 0x1f},   // 'z'
+    {0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02},   // '{'
+    {0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04},   // '|'
+    {0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08},   // '}'
+    {0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00},   // '~'
+};
+
+// a vertex of the UI, in window coordinates (boxels, y up) with atlas texture coordinates and a color
+struct BLUfxUiVertex_t
+{
+    float x, y;
+    float u, v;
+    unsigned int color;         // UI_RGBA
+};
+typedef BLUfxUiVertex_t BLUfxUiVertex;
+
+// state of an immediate-mode UI: the vertices of the current frame, the layout cursor and the mouse
+struct BLUfxUi_t
+{
+    std::vector<BLUfxUiVertex> vertices;
+    std::vector<BLUfxUiVertex> images;  // drawn after vertices, with the image texture (coordinates in [0, 1], v up)
+    int left, top, right, bottom;       // of the window
+    int y;                              // top of the current row
+    int nextId;                         // items are identified by their order within the frame
+    int activeId;                       // item that was pressed and is being held (0 = none)
+    int mouseX, mouseY, mouseDown;
+    int mousePressed, mouseReleased;    // since the last frame
+    int focusedId;                      // text field that takes the keys (0 = none)
+    char keys[UI_MAX_KEYS];             // typed since the last frame, characters and UI_KEY_*
+    int keyCount;
+};
+typedef BLUfxUi_t BLUfxUi;
+
+// fills an RGBA atlas of UI_ATLAS_WIDTH x UI_ATLAS_HEIGHT texels (white, with the glyphs in the alpha channel), the
+// first texel row is the top of the texture
+static void UiBuildFontAtlas(unsigned char *rgba)
+{
+    memset(rgba, 0, UI_ATLAS_WIDTH * UI_ATLAS_HEIGHT * 4);
+    for (int glyph = 0; glyph <= UI_FONT_GLYPHS; glyph++)
+    {
+        int cellX = (glyph % UI_ATLAS_COLUMNS) * UI_ATLAS_CELL, cellY = (glyph / UI_ATLAS_COLUMNS) * UI_ATLAS_CELL;
+        for (int row = 0; row < UI_ATLAS_CELL; row++)
+        {
+            for (int column = 0; column < UI_ATLAS_CELL; column++)
+            {
+                bool set = glyph == UI_SOLID_CELL || (row < UI_GLYPH_HEIGHT && column < UI_GLYPH_WIDTH && (BLUfxUiFont[glyph][row] & (0x10 >> column)));
+                unsigned char *texel = rgba + ((cellY + row) * UI_ATLAS_WIDTH + cellX + column) * 4;
+                texel[0] = texel[1] = texel[2] = 255;
+                texel[3] = set ? 255 : 0;
+            }
+        }
+    }
+}
+
+// adds a textured quad (two triangles) from the atlas cell region [u0, u1] x [v0, v1] (in texels, v down)
+static void UiQuad(BLUfxUi *ui, float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, unsigned int color)
+{
+    u0 /= UI_ATLAS_WIDTH; u1 /= UI_ATLAS_WIDTH;
+    v0 /= UI_ATLAS_HEIGHT; v1 /= UI_ATLAS_HEIGHT;
+    BLUfxUiVertex quad[6] =
+    {
+        {x0, y1, u0, v0, color}, {x0, y0, u0, v1, color}, {x1, y0, u1, v1, color},
+        {x0, y1, u0, v0, color}, {x1, y0, u1, v1, color}, {x1, y1, u1, v0, color}
+    };
+    ui->vertices.insert(ui->vertices.end(), quad, quad + 6);
+}
+
+// adds a solid rectangle (y0 is the bottom)
+static void UiRect(BLUfxUi *ui, float x0, float y0, float x1, float y1, unsigned int color)
+{
+    float u = (UI_SOLID_CELL % UI_ATLAS_COLUMNS) * UI_ATLAS_CELL + UI_ATLAS_CELL / 2, v = (UI_SOLID_CELL / UI_ATLAS_COLUMNS) * UI_ATLAS_CELL + UI_ATLAS_CELL / 2;
+    UiQuad(ui, x0, y0, x1, y1, u, v, u, v, color);
+}
+
+// returns the width of a text in boxels
+static inline int UiTextWidth(const char *text)
+{
+    int length = (int) strlen(text);
+    return length > 0 ? length * UI_CHAR_ADVANCE - UI_SCALE : 0;
+}
+
+// adds a text, x and y are the left and top of its first character
+static void UiText(BLUfxUi *ui, float x, float y, const char *text, unsigned int color)
+{
+    for (const char *c = text; *c != '\0'; c++, x += UI_CHAR_ADVANCE)
+    {
+        int glyph = (unsigned char) *c - UI_FONT_FIRST;
+        if (glyph <= 0 || glyph >= UI_FONT_GLYPHS)
+            continue;   // space, or not in the font
+
+        float u = (glyph % UI_ATLAS_COLUMNS) * UI_ATLAS_CELL, v = (glyph / UI_ATLAS_COLUMNS) * UI_ATLAS_CELL;
+        UiQuad(ui, x, y - UI_TEXT_HEIGHT, x + UI_GLYPH_WIDTH * UI_SCALE, y, u, v, u + UI_GLYPH_WIDTH, v + UI_GLYPH_HEIGHT, color);
+    }
+}
+
+// starts a frame of the UI for a window with the given geometry, with the background and the cursor at the top
+static void UiBegin(BLUfxUi *ui, int left, int top, int right, int bottom)
+{
+    ui->vertices.clear();
+    ui->images.clear();
+    ui->left = left;
+    ui->top = top;
+    ui->right = right;
+    ui->bottom = bottom;
+    ui->y = top - UI_PADDING;
+    ui->nextId = 1;
+
+    UiRect(ui, (float) left, (float) bottom, (float) right, (float) top, UI_COLOR_BACKGROUND);
+}
+
+// ends a frame of the UI: the mouse events have been handled
+static void UiEnd(BLUfxUi *ui)
+{
+    if (!ui->mouseDown)
+        ui->activeId = 0;
+    ui->mousePressed = ui->mouseReleased = 0;
+    ui->keyCount = 0;
+}
+
+// adds a key typed while a text field has the focus, handled when the UI is described next
+static void UiTypeKey(BLUfxUi *ui, char key)
+{
+    bool printable = key >= ' ' && key <= '~';
+    if (ui->keyCount < UI_MAX_KEYS && (printable || key == UI_KEY_BACKSPACE || key == UI_KEY_RETURN || key == UI_KEY_ESCAPE))
+        ui->keys[ui->keyCount++] = key;
+}
+
+// moves the cursor to the next row
+static inline void UiNextRow(BLUfxUi *ui, int height = UI_ROW_HEIGHT)
+{
+    ui->y -= height;
+}
+
+// the left and right edges of the content area of the window
+static inline int UiContentLeft(const BLUfxUi *ui)
+{
+    return ui->left + UI_PADDING;
+}
+static inline int UiContentRight(const BLUfxUi *ui)
+{
+    return ui->right - UI_PADDING;
+}
+
+// adds a quad of the image texture (y0 is the bottom, v0 the bottom of the image region)
+static void UiImage(BLUfxUi *ui, float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1)
+{
+    unsigned int color = UI_RGBA(255, 255, 255, 255);
+    BLUfxUiVertex quad[6] =
+    {
+        {x0, y1, u0, v1, color}, {x0, y0, u0, v0, color}, {x1, y0, u1, v0, color},
+        {x0, y1, u0, v1, color}, {x1, y0, u1, v0, color}, {x1, y1, u1, v1, color}
+    };
+    ui->images.insert(ui->images.end(), quad, quad + 6);
+}
+
+// handles the mouse for an item in [x0, x1] of the current row, returns its id and whether it is hovered
+static int UiItem(BLUfxUi *ui, int x0, int x1, bool enabled, bool *hovered, int height = UI_ITEM_HEIGHT)
+{
+    int id = ui->nextId++;
+    int y0 = ui->y - height;
+    *hovered = enabled && ui->mouseX >= x0 && ui->mouseX < x1 && ui->mouseY > y0 && ui->mouseY <= ui->y;
+    if (*hovered && ui->mousePressed && ui->activeId == 0)
+        ui->activeId = id;
+
+    return id;
+}
+
+// adds a text in the current row, vertically centered like the items
+static void UiLabel(BLUfxUi *ui, int x, const char *text, unsigned int color = UI_COLOR_TEXT)
+{
+    UiText(ui, (float) x, (float) (ui->y - (UI_ITEM_HEIGHT - UI_TEXT_HEIGHT) / 2), text, color);
+}
+
+// adds a section header with a line below it and moves to the next row
+static void UiHeader(BLUfxUi *ui, const char *text)
+{
+    UiLabel(ui, UiContentLeft(ui), text, UI_COLOR_HEADER);
+    UiRect(ui, (float) UiContentLeft(ui), (float) (ui->y - UI_ITEM_HEIGHT - 2), (float) UiContentRight(ui), (float) (ui->y - UI_ITEM_HEIGHT), UI_COLOR_LINE);
+    UiNextRow(ui, UI_ROW_HEIGHT + 4);
+}
+
+// adds a button in [x0, x1] of the current row, returns true when it was clicked (pressed and released on it); a
+// selected button is shown as active and can't be clicked
+static bool UiButton(BLUfxUi *ui, int x0, int x1, const char *label, bool enabled = true, bool selected = false)
+{
+    bool hovered;
+    int id = UiItem(ui, x0, x1, enabled && !selected, &hovered);
+    bool held = ui->activeId == id;
+
+    unsigned int color = selected ? UI_COLOR_ITEM_ACTIVE : (held || hovered ? UI_COLOR_ITEM_HOT : UI_COLOR_ITEM);
+    UiRect(ui, (float) x0, (float) (ui->y - UI_ITEM_HEIGHT), (float) x1, (float) ui->y, color);
+
+    // the label is centered, and cut off if it doesn't fit
+    char text[64];
+    int maxLength = std::max(0, (x1 - x0 - 2 * UI_SCALE) / UI_CHAR_ADVANCE);
+    snprintf(text, sizeof(text), "%.*s", std::min(maxLength, (int) sizeof(text) - 1), label);
+    UiLabel(ui, x0 + (x1 - x0 - UiTextWidth(text)) / 2, text, enabled || selected ? UI_COLOR_TEXT : UI_COLOR_TEXT_DISABLED);
+
+    return held && hovered && ui->mouseReleased;
+}
+
+// adds a tile of the given height in [x0, x1] of the current row, showing the image region [u0, u1] x [v0, v1] above
+// its label, returns true when it was clicked; a selected tile is framed and can't be clicked
+static bool UiImageButton(BLUfxUi *ui, int x0, int x1, int height, const char *label, bool selected, float u0, float v0, float u1, float v1)
+{
+    bool hovered;
+    int id = UiItem(ui, x0, x1, !selected, &hovered, height);
+    bool held = ui->activeId == id;
+
+    float y0 = (float) (ui->y - height), y1 = (float) ui->y, labelHeight = (float) (UI_TEXT_HEIGHT + 4);
+    UiRect(ui, (float) x0, y0, (float) x1, y1, selected ? UI_COLOR_ITEM_ACTIVE : (held || hovered ? UI_COLOR_ITEM_HOT : UI_COLOR_ITEM));
+    UiImage(ui, (float) (x0 + 2), y0 + labelHeight, (float) (x1 - 2), y1 - 2, u0, v0, u1, v1);
+
+    char text[64];
+    int maxLength = std::max(0, (x1 - x0 - 2 * UI_SCALE) / UI_CHAR_ADVANCE);
+    snprintf(text, sizeof(text), "%.*s", std::min(maxLength, (int) sizeof(text) - 1), label);
+    UiText(ui, (float) (x0 + (x1 - x0 - UiTextWidth(text)) / 2), y0 + labelHeight - 2, text, UI_COLOR_TEXT);
+
+    return held && hovered && ui->mouseReleased;
+}
+
+// adds a checkbox with its label starting at x, returns true when it was toggled
+static bool UiCheckbox(BLUfxUi *ui, int x, const char *label, int *value)
+{
+    int box = UI_ITEM_HEIGHT - 4;
+    bool hovered;
+    int id = UiItem(ui, x, x + box + UI_PADDING / 2 + UiTextWidth(label), true, &hovered);
+    bool clicked = ui->activeId == id && hovered && ui->mouseReleased;
+    if (clicked)
+        *value = !*value;
+
+    float y = (float) (ui->y - 2);
+    UiRect(ui, (float) x, y - box, (float) (x + box), y, hovered ? UI_COLOR_ITEM_HOT : UI_COLOR_ITEM);
+    if (*value)
+        UiRect(ui, (float) (x + 4), y - box + 4, (float) (x + box - 4), y - 4, UI_COLOR_ITEM_ACTIVE);
+    UiLabel(ui, x + box + UI_PADDING / 2, label);
+
+    return clicked;
+}
+
+// adds a horizontal slider in [x0, x1] of the current row for an integer position in [min, max], returns true when
+// the position was changed by dragging it
+static bool UiSlider(BLUfxUi *ui, int x0, int x1, int *position, int min, int max)
+{
+    bool hovered;
+    int id = UiItem(ui, x0, x1, true, &hovered);
+    int knob = UI_ITEM_HEIGHT / 2;
+
+    bool changed = false;
+    if (ui->activeId == id && max > min)
+    {
+        float t = (float) (ui->mouseX - x0 - knob) / (float) std::max(1, x1 - x0 - 2 * knob);
+        int dragged = min + (int) lrintf(std::min(std::max(t, 0.0f), 1.0f) * (max - min));
+        changed = dragged != *position;
+        *position = dragged;
+    }
+
+    float t = max > min ? (float) (std::min(std::max(*position, min), max) - min) / (float) (max - min) : 0.0f;
+    float center = x0 + knob + t * (x1 - x0 - 2 * knob);
+    float y = (float) (ui->y - UI_ITEM_HEIGHT / 2);
+    UiRect(ui, (float) x0, y - 3, (float) x1, y + 3, UI_COLOR_TRACK);
+    UiRect(ui, center - knob / 2, (float) (ui->y - UI_ITEM_HEIGHT), center + knob / 2, (float) ui->y, ui->activeId == id ? UI_COLOR_ITEM_ACTIVE : (hovered ? UI_COLOR_ITEM_HOT : UI_COLOR_ITEM));
+
+    return changed;
+}
+
+// adds a text field in [x0, x1] of the current row for a text of up to size - 1 characters, returns true when the text
+// was changed by typing; a click on it gives it the focus, a click elsewhere, return or escape take it away
+static bool UiTextField(BLUfxUi *ui, int x0, int x1, char *text, int size)
+{
+    bool hovered;
+    int id = UiItem(ui, x0, x1, true, &hovered);
+    if (ui->mousePressed)
+        ui->focusedId = (hovered ? id : (ui->focusedId == id ? 0 : ui->focusedId));
+
+    bool changed = false;
+    for (int i = 0; ui->focusedId == id && i < ui->keyCount; i++)
+    {
+        int length = (int) strlen(text);
+        if (ui->keys[i] == UI_KEY_BACKSPACE && length > 0)
+        {
+            text[length - 1] = '\0';
+            changed = true;
+        }
+        else if (ui->keys[i] == UI_KEY_RETURN || ui->keys[i] == UI_KEY_ESCAPE)
+            ui->focusedId = 0;
+        else if (ui->keys[i] != UI_KEY_BACKSPACE && length < size - 1)
+        {
+            text[length] = ui->keys[i];
+            text[length + 1] = '\0';
+            changed = true;
+        }
+    }
+
+    bool focused = ui->focusedId == id;
+    UiRect(ui, (float) x0, (float) (ui->y - UI_ITEM_HEIGHT), (float) x1, (float) ui->y, focused ? UI_COLOR_ITEM_ACTIVE : (hovered ? UI_COLOR_ITEM_HOT : UI_COLOR_ITEM));
+    UiRect(ui, (float) (x0 + 1), (float) (ui->y - UI_ITEM_HEIGHT + 1), (float) (x1 - 1), (float) (ui->y - 1), UI_COLOR_FIELD);
+
+    // the end of the text stays visible, followed by the cursor while focused
+    int maxLength = std::max(0, (x1 - x0 - UI_PADDING - UI_CHAR_ADVANCE) / UI_CHAR_ADVANCE);
+    const char *shown = text + std::max(0, (int) strlen(text) - maxLength);
+    UiLabel(ui, x0 + UI_PADDING / 2, shown);
+    if (focused)
+    {
+        float x = (float) (x0 + UI_PADDING / 2 + UiTextWidth(shown) + UI_SCALE);
+        UiRect(ui, x, (float) (ui->y - UI_ITEM_HEIGHT + 3), x + UI_SCALE, (float) (ui->y - 3), UI_COLOR_TEXT);
+    }
+
+    return changed;
+}
+
+#endif
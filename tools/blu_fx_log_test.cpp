@@ -0,0 +1,143 @@
+/* Copyright (C) 2024  Steve Goldberg
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// test of the log queue (blu_fx_log.h), runs headless without X-Plane:
+//
+//   blu_fx_log_test
+//
+// checks that long messages are cut, then lets several threads write messages of several records each while the
+// consumer drains the queue as fast as it can, and checks that no drain writes past its batch, that the records of a
+// message stay together and that every message either arrives whole or is counted as dropped; exits with 1 if a check
+// fails
+
+#include "blu_fx_log.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdlib.h>
+
+#define TEST_THREADS 4
+#define TEST_MESSAGES 5000              /* per thread */
+#define TEST_MESSAGE_LENGTH 600         /* characters, three records */
+#define TEST_GUARD 64                   /* bytes after the batch that a drain must not touch */
+
+static int failures = 0;
+
+#define CHECK(condition) ((condition) ? (void) 0 : (void) (failures++, fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition)))
+
+static BLUfxLog logQueue;
+static char batch[LOG_QUEUE_SIZE * LOG_RECORD_SIZE + TEST_GUARD];
+
+// drains the queue into text, returns the number of dropped messages
+static uint32_t Drain(std::string *text)
+{
+    uint32_t dropped = 0;
+    memset(batch + LOG_QUEUE_SIZE * LOG_RECORD_SIZE, 0x5a, TEST_GUARD);
+    size_t length = DrainLog(&logQueue, batch, &dropped);
+    CHECK(length < LOG_QUEUE_SIZE * LOG_RECORD_SIZE && strlen(batch) == length);
+    for (int i = 0; i < TEST_GUARD; i++)
+        CHECK(batch[LOG_QUEUE_SIZE * LOG_RECORD_SIZE + i] == 0x5a);
+    text->append(batch, length);
+
+    return dropped;
+}
+
+// checks the levels and that a text longer than a formatted message is cut to LOG_MESSAGE_RECORDS records
+static void TestCut(void)
+{
+    InitLog(&logQueue, LOG_INFO);
+    std::string text;
+    LogWrite(&logQueue, LOG_DEBUG, "debug\n");
+    LogFormat(&logQueue, LOG_INFO, "info %d\n", 1);
+    std::string long_(3000, 'x');
+    LogWrite(&logQueue, LOG_ERROR, long_.c_str());
+    CHECK(Drain(&text) == 0);
+    CHECK(text == "info 1\n" + std::string(LOG_MESSAGE_RECORDS * (LOG_RECORD_SIZE - 1), 'x'));
+}
+
+// writes the messages of a thread: "<thread>:<number>:" followed by the letter of the thread up to the length
+static void Produce(int thread)
+{
+    char message[TEST_MESSAGE_LENGTH + 2];
+    for (int i = 0; i < TEST_MESSAGES; i++)
+    {
+        int prefix = snprintf(message, sizeof(message), "%d:%d:", thread, i);
+        memset(message + prefix, 'a' + thread, TEST_MESSAGE_LENGTH - prefix);
+        message[TEST_MESSAGE_LENGTH] = '\n';
+        message[TEST_MESSAGE_LENGTH + 1] = '\0';
+        LogWrite(&logQueue, LOG_INFO, message);
+    }
+}
+
+// checks the queue with producers that keep refilling it while it is drained
+static void TestConcurrentWrites(void)
+{
+    InitLog(&logQueue, LOG_INFO);
+    std::atomic<int> running(TEST_THREADS);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < TEST_THREADS; i++)
+        threads.push_back(std::thread([i, &running]() { Produce(i); running--; }));
+
+    std::string text;
+    uint32_t dropped = 0;
+    while (running.load() > 0)
+        dropped += Drain(&text);
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    dropped += Drain(&text);
+
+    // every line is a whole message, and the messages of a thread arrive in order
+    int received = 0, last[TEST_THREADS];
+    bool whole = true, ordered = true;
+    for (int i = 0; i < TEST_THREADS; i++)
+        last[i] = -1;
+    for (size_t start = 0, end; start < text.size(); start = end + 1)
+    {
+        end = text.find('\n', start);
+        if (end == std::string::npos)
+            end = text.size();
+        std::string line = text.substr(start, end - start);
+        int thread = -1, number = -1, prefix = 0;
+        if (sscanf(line.c_str(), "%d:%d:%n", &thread, &number, &prefix) != 2 || thread < 0 || thread >= TEST_THREADS || line.size() != TEST_MESSAGE_LENGTH || line.find_first_not_of((char) ('a' + thread), prefix) != std::string::npos)
+        {
+            if (whole)
+                fprintf(stderr, "broken message: %.80s...\n", line.c_str());
+            whole = false;
+            continue;
+        }
+        ordered = ordered && number > last[thread];
+        last[thread] = number;
+        received++;
+    }
+    CHECK(whole);
+    CHECK(ordered);
+    CHECK(received + (int) dropped == TEST_THREADS * TEST_MESSAGES);
+    CHECK(received > 0);
+}
+
+int main(void)
+{
+    TestCut();
+    TestConcurrentWrites();
+
+    if (failures == 0)
+        printf("log queue: all checks passed\n");
+
+    return failures == 0 ? 0 : 1;
+}
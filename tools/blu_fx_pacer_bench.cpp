@@ -0,0 +1,220 @@
+/* Copyright (C) 2024  Steve Goldberg
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// standalone bench of the FPS-Limiter's frame pacer (blu_fx_pacer.h), runs headless without X-Plane:
+//
+//   blu_fx_pacer_bench [--clock fake|real] [--fps 30] [--frames 1000] [--oversleep 200] [--seed 1] [--workload ...]
+//
+// workloads (frame times in ms, i.e. the work done between two calls of LimitFps):
+//   constant:12                 every frame takes 12 ms
+//   bursty:12,45,300,20         12 ms, but every 300 frames 20 frames take 45 ms (e.g. scenery loads)
+//   trace:frames.txt            one frame time per line, e.g. recorded from blu_fx/stats (repeated if too short)
+//
+// with the fake clock, time only advances by the workload, by sleeps (which wake up to --oversleep us late, like a
+// real scheduler) and by 1 us per clock read while spinning, so a run is instant and reproducible; with the real clock
+// the workload is slept and the CPU time spent in LimitFps is measured with getrusage
+
+#include "blu_fx_pacer.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#define FAKE_CLOCK_SPIN_STEP 0.000001   /* seconds per clock read while spinning */
+
+// state of the fake clock
+static double fakeTime = 1.0, fakeSpinTime = 0.0, fakeMaxOversleep = 0.0002;
+static bool fakeSpinning = false;
+
+// fake clock: every read while waiting costs FAKE_CLOCK_SPIN_STEP of (spun) CPU time
+static double FakeNow(void)
+{
+    if (fakeSpinning)
+    {
+        fakeTime += FAKE_CLOCK_SPIN_STEP;
+        fakeSpinTime += FAKE_CLOCK_SPIN_STEP;
+    }
+
+    return fakeTime;
+}
+
+// fake sleep: wakes up between 0 and fakeMaxOversleep seconds late
+static void FakeSleepUntil(double time)
+{
+    if (time > fakeTime)
+        fakeTime = time + fakeMaxOversleep * rand() / RAND_MAX;
+}
+
+static const BLUfxClock BLUfxFakeClock = {FakeNow, FakeSleepUntil};
+
+// synthetic workload, see the usage above
+struct BLUfxWorkload_t
+{
+    double base, burst;         // seconds
+    int burstEvery, burstLength;
+    std::vector<double> trace;  // seconds
+};
+typedef BLUfxWorkload_t BLUfxWorkload;
+
+// parses a workload description, returns false if it is invalid
+static bool ParseWorkload(const char *description, BLUfxWorkload *workload)
+{
+    workload->base = workload->burst = 0.0;
+    workload->burstEvery = workload->burstLength = 0;
+
+    double base, burst;
+    if (sscanf(description, "constant:%lf", &base) == 1)
+        workload->base = base / 1000.0;
+    else if (sscanf(description, "bursty:%lf,%lf,%d,%d", &base, &burst, &workload->burstEvery, &workload->burstLength) == 4 && workload->burstEvery > 0)
+    {
+        workload->base = base / 1000.0;
+        workload->burst = burst / 1000.0;
+    }
+    else if (strncmp(description, "trace:", 6) == 0)
+    {
+        std::ifstream file(description + 6);
+        double frameTime;
+        while (file >> frameTime)
+            workload->trace.push_back(frameTime / 1000.0);
+        if (workload->trace.empty())
+            return false;
+    }
+    else
+        return false;
+
+    return true;
+}
+
+// returns how long the given frame takes without the limiter, in seconds
+static double WorkloadFrameTime(const BLUfxWorkload *workload, int frame)
+{
+    if (!workload->trace.empty())
+        return workload->trace[frame % workload->trace.size()];
+    if (workload->burstEvery > 0 && frame % workload->burstEvery < workload->burstLength)
+        return workload->burst;
+
+    return workload->base;
+}
+
+// returns the CPU time (user and system) of the calling thread in seconds
+static double GetThreadCpuTime(void)
+{
+    rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1.0e-6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1.0e-6;
+}
+
+int main(int argc, char **argv)
+{
+    bool realClock = false;
+    float fps = 30.0f;
+    int frames = 1000;
+    const char *workloadDescription = "constant:12";
+    unsigned int seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL)
+            arg = "--help";
+
+        if (arg == "--clock")
+            realClock = strcmp(value, "real") == 0;
+        else if (arg == "--fps")
+            fps = (float) atof(value);
+        else if (arg == "--frames")
+            frames = atoi(value);
+        else if (arg == "--oversleep")
+            fakeMaxOversleep = atof(value) * 1.0e-6;
+        else if (arg == "--seed")
+            seed = (unsigned int) atoi(value);
+        else if (arg == "--workload")
+            workloadDescription = value;
+        else
+        {
+            fprintf(stderr, "usage: %s [--clock fake|real] [--fps 30] [--frames 1000] [--oversleep us] [--seed n] [--workload constant:ms|bursty:ms,burst_ms,every,length|trace:file]\n", argv[0]);
+            return 2;
+        }
+        i++;
+    }
+
+    BLUfxWorkload workload;
+    if (fps <= 0.0f || frames < 2 || !ParseWorkload(workloadDescription, &workload))
+    {
+        fprintf(stderr, "%s: invalid --fps, --frames or --workload\n", argv[0]);
+        return 2;
+    }
+
+    srand(seed);
+    const BLUfxClock *clock = realClock ? &BLUfxSystemClock : &BLUfxFakeClock;
+    BLUfxPacer pacer;
+    ResetPacer(&pacer, clock);
+
+    // run the frames like the limiter flightloop: wait at the start of each frame, then do the work of the frame
+    std::vector<double> frameStarts;
+    frameStarts.reserve(frames);
+    double waitCpuTime = 0.0;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        double cpuTime = realClock ? GetThreadCpuTime() : 0.0;
+        fakeSpinning = true;
+        LimitFps(&pacer, fps);
+        fakeSpinning = false;
+        if (realClock)
+            waitCpuTime += GetThreadCpuTime() - cpuTime;
+
+        double start = clock->now();
+        frameStarts.push_back(start);
+        clock->sleepUntil(start + WorkloadFrameTime(&workload, frame));
+    }
+    if (!realClock)
+        waitCpuTime = fakeSpinTime;
+
+    // jitter: deviation of the frame periods from the target period
+    double period = 1.0 / fps, sum = 0.0, squareSum = 0.0;
+    std::vector<double> deviations;
+    for (size_t i = 1; i < frameStarts.size(); i++)
+    {
+        double deviation = (frameStarts[i] - frameStarts[i - 1]) - period;
+        sum += deviation;
+        squareSum += deviation * deviation;
+        deviations.push_back(fabs(deviation));
+    }
+    std::sort(deviations.begin(), deviations.end());
+    double mean = sum / deviations.size();
+    double stddev = sqrt(std::max(0.0, squareSum / deviations.size() - mean * mean));
+    double p99 = deviations[std::min(deviations.size() - 1, (size_t) ceil(0.99 * deviations.size()) - 1)];
+    double elapsed = frameStarts.back() - frameStarts.front();
+
+    printf("clock:            %s\n", realClock ? "real" : "fake");
+    printf("workload:         %s\n", workloadDescription);
+    printf("frames:           %d (%ld paced)\n", frames, pacer.pacedFrames);
+    printf("target rate:      %.2f fps\n", fps);
+    printf("achieved rate:    %.2f fps\n", (frameStarts.size() - 1) / elapsed);
+    printf("jitter stddev:    %.1f us\n", stddev * 1.0e6);
+    printf("jitter p99:       %.1f us\n", p99 * 1.0e6);
+    printf("jitter max:       %.1f us\n", deviations.back() * 1.0e6);
+    printf("spin margin:      %.1f us\n", pacer.spinMargin * 1.0e6);
+    printf("wait CPU time:    %.3f s (%.2f%% of %.3f s)%s\n", waitCpuTime, 100.0 * waitCpuTime / elapsed, elapsed, realClock ? "" : " (simulated spinning)");
+
+    return 0;
+}
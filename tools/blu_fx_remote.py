@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# Minimal remote control and grade sync client for BLU-fx (see "Remote control" and "Grade sync" in README.md).
+#
+# Sends one parameter update to the plugin's remote control port on this machine, e.g.:
+#   tools/blu_fx_remote.py brightness=0.05 contrast=1.1
+#   tools/blu_fx_remote.py --port 49590 --sequence 42 vignette=0.6
+# (requires "remoteControlEnabled=1" in blu_fx.ini)
+#
+# Stands in for a sync master (sending to the multicast group) or a sync follower (printing what the master sends):
+#   tools/blu_fx_remote.py --group 239.255.70.88 --port 49591 saturation=1.2
+#   tools/blu_fx_remote.py --group 239.255.70.88 --port 49591 --listen
+
+import argparse, socket, struct, time
+
+# same order as BLUfxParams_t in blu_fx.cpp (bit i of the mask = parameter i)
+PARAMS = [
+	"brightness",
+	"contrast",
+	"saturation",
+	"redScale",
+	"greenScale",
+	"blueScale",
+	"redOffset",
+	"greenOffset",
+	"blueOffset",
+	"vignette",
+]
+
+def build_message(sequence, values):
+	mask = 0
+	payload = b""
+	for i, name in enumerate(PARAMS):
+		if name in values:
+			mask |= 1 << i
+			payload += struct.pack("<f", values[name])
+	return b"BLFX" + struct.pack("<II", sequence & 0xffffffff, mask) + payload
+
+def parse_message(data):
+	if len(data) < 12 or data[:4] != b"BLFX":
+		return None
+	sequence, mask = struct.unpack("<II", data[4:12])
+	values = {}
+	offset = 12
+	for i, name in enumerate(PARAMS):
+		if mask & (1 << i):
+			values[name] = struct.unpack("<f", data[offset:offset + 4])[0]
+			offset += 4
+	return sequence, values
+
+def listen(group, port):
+	sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+	sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+	if hasattr(socket, "SO_REUSEPORT"):
+		sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+	sock.bind(("", port))
+	sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, socket.inet_aton(group) + socket.inet_aton("0.0.0.0"))
+	while True:
+		message = parse_message(sock.recv(1024))
+		if message:
+			sequence, values = message
+			print("%10d %s" % (sequence, " ".join("%s=%.3f" % item for item in values.items()) or "(heartbeat)"))
+
+def main():
+	parser = argparse.ArgumentParser(description="Send a grading update to BLU-fx, or listen to a sync master.")
+	parser.add_argument("--port", type=int, default=None, help="49590 for remote control, 49591 for sync")
+	parser.add_argument("--group", default=None, help="sync multicast group instead of the local remote control port")
+	parser.add_argument("--sequence", type=int, default=None, help="defaults to the current time in ms")
+	parser.add_argument("--listen", action="store_true", help="print the messages sent to the sync group")
+	parser.add_argument("values", nargs="*", metavar="name=value")
+	args = parser.parse_args()
+
+	port = args.port if args.port is not None else (49591 if args.group else 49590)
+	if args.listen:
+		if not args.group:
+			parser.error("--listen requires --group")
+		listen(args.group, port)
+		return
+
+	values = {}
+	for item in args.values:
+		name, _, value = item.partition("=")
+		if name not in PARAMS:
+			parser.error("unknown parameter: %s (one of %s)" % (name, ", ".join(PARAMS)))
+		values[name] = float(value)
+
+	sequence = args.sequence if args.sequence is not None else int(time.time() * 1000)
+	sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+	if args.group:
+		sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+	sock.sendto(build_message(sequence, values), (args.group or "127.0.0.1", port))
+
+if __name__ == "__main__":
+	main()
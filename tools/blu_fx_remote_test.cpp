@@ -0,0 +1,249 @@
+/* Copyright (C) 2024  Steve Goldberg
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// loopback test of the remote control and the grade sync (blu_fx_remote.h), runs headless without X-Plane:
+//
+//   blu_fx_remote_test [tools/blu_fx_remote.py]
+//
+// runs the plugin's receiving thread on a free port of 127.0.0.1, sends it messages and checks what arrives in the
+// mailbox the plugin takes its parameter updates from; if the path of the python client is given, it is used as a
+// local client too; then runs a sync master and a follower on the multicast group (looped back on this machine),
+// including a restart of the master; exits with 1 if a check fails
+
+#include "blu_fx_remote.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_PARAMS 10                  /* BLUfxParams_t of blu_fx.cpp */
+#define TEST_TIMEOUT 2000               /* ms to wait for a message to arrive */
+#define TEST_SYNC_GROUP "239.255.70.88"
+
+enum
+{
+    TEST_BRIGHTNESS = 0,
+    TEST_CONTRAST = 1,
+    TEST_SATURATION = 2,
+    TEST_VIGNETTE = 9
+};
+
+static int failures = 0;
+
+#define CHECK(condition) ((condition) ? (void) 0 : (void) (failures++, fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition)))
+
+static BLUfxLog logQueue;
+static BLUfxRemoteMailbox mailbox;
+
+// sends a message to the receiving socket
+static void SendMessage(BLUfxSocket sendSocket, int port, const unsigned char *buffer, int length)
+{
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((unsigned short) port);
+    sendto(sendSocket, (const char *) buffer, length, 0, (sockaddr *) &address, sizeof(address));
+}
+
+// sends the masked values with the given sequence number
+static void SendParams(BLUfxSocket sendSocket, int port, uint32_t sequence, unsigned int mask, const float *values)
+{
+    unsigned char buffer[REMOTE_MESSAGE_MAX_SIZE];
+    SendMessage(sendSocket, port, buffer, BuildParamMessage(buffer, sequence, mask, values));
+}
+
+// waits for parameters to arrive in the mailbox, returns their mask (0 = timeout)
+static unsigned int WaitForMailbox(float *values)
+{
+    for (int elapsed = 0; elapsed < TEST_TIMEOUT; elapsed++)
+    {
+        unsigned int mask = TakeRemoteMailbox(&mailbox, values);
+        if (mask != 0)
+            return mask;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return 0;
+}
+
+// checks the remote control, with the python client if its path is given
+static void TestRemoteControl(const char *pythonClient)
+{
+    BLUfxSocket receiveSocket = OpenRemoteControlSocket(0);
+    if (receiveSocket == INVALID_BLUFX_SOCKET)
+    {
+        CHECK(!"unable to open a port on 127.0.0.1");
+        return;
+    }
+    sockaddr_in address;
+    socklen_t addressLength = sizeof(address);
+    getsockname(receiveSocket, (sockaddr *) &address, &addressLength);
+    int port = ntohs(address.sin_port);
+
+    BLUfxParamReceiver receiver;
+    ResetParamReceiver(&receiver, &mailbox, TEST_PARAMS, &logQueue, "test: ");
+    std::atomic<bool> running(true);
+    std::thread receiveThread(ReceiveParamMessages, receiveSocket, &receiver, &running);
+
+    BLUfxSocket sendSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    float sent[REMOTE_MAX_PARAMS] = {0.0f}, received[REMOTE_MAX_PARAMS] = {0.0f};
+
+    // a message arrives with exactly the parameters it carries
+    sent[TEST_BRIGHTNESS] = 0.05f;
+    sent[TEST_VIGNETTE] = 0.4f;
+    SendParams(sendSocket, port, 100, (1u << TEST_BRIGHTNESS) | (1u << TEST_VIGNETTE), sent);
+    unsigned int mask = WaitForMailbox(received);
+    CHECK(mask == ((1u << TEST_BRIGHTNESS) | (1u << TEST_VIGNETTE)));
+    CHECK(received[TEST_BRIGHTNESS] == 0.05f && received[TEST_VIGNETTE] == 0.4f);
+
+    // duplicates, late and malformed messages and bits beyond the parameters are dropped; messages are received in
+    // order, so once the last one has arrived, the others have been dealt with
+    sent[TEST_CONTRAST] = 2.0f;
+    SendParams(sendSocket, port, 100, 1u << TEST_CONTRAST, sent);
+    SendParams(sendSocket, port, 99, 1u << TEST_CONTRAST, sent);
+    unsigned char buffer[REMOTE_MESSAGE_MAX_SIZE];
+    int length = BuildParamMessage(buffer, 101, 1u << TEST_CONTRAST, sent);
+    SendMessage(sendSocket, port, buffer, length - 1);
+    memcpy(buffer, "XXXX", 4);
+    SendMessage(sendSocket, port, buffer, length);
+    sent[TEST_SATURATION] = 1.2f;
+    sent[TEST_PARAMS] = 3.0f;
+    SendParams(sendSocket, port, 102, (1u << TEST_SATURATION) | (1u << TEST_PARAMS), sent);
+    mask = WaitForMailbox(received);
+    CHECK(mask == (1u << TEST_SATURATION));
+    CHECK(received[TEST_SATURATION] == 1.2f);
+
+    // a restarted sender (sequence far behind) is accepted right away
+    sent[TEST_CONTRAST] = 1.1f;
+    SendParams(sendSocket, port, 102 - 2 * REMOTE_SEQUENCE_WINDOW, 1u << TEST_CONTRAST, sent);
+    mask = WaitForMailbox(received);
+    CHECK(mask == (1u << TEST_CONTRAST));
+    CHECK(received[TEST_CONTRAST] == 1.1f);
+
+    // the python client, as a grading panel would send
+    if (pythonClient != NULL)
+    {
+        std::string command = std::string("python3 \"") + pythonClient + "\" --port " + std::to_string(port) + " --sequence 200 brightness=0.25 vignette=0.6";
+        CHECK(system(command.c_str()) == 0);
+        mask = WaitForMailbox(received);
+        CHECK(mask == ((1u << TEST_BRIGHTNESS) | (1u << TEST_VIGNETTE)));
+        CHECK(received[TEST_BRIGHTNESS] == 0.25f && received[TEST_VIGNETTE] == 0.6f);
+    }
+
+    running.store(false);
+    receiveThread.join();
+    CloseSocket(sendSocket);
+    CloseSocket(receiveSocket);
+}
+
+// checks a sync master and follower, and that the follower takes up a restarted master right away
+static void TestGradeSync(void)
+{
+    BLUfxSocket followerSocket = OpenSyncSocket(TEST_SYNC_GROUP, 0, false);
+    BLUfxSocket masterSocket = OpenSyncSocket(TEST_SYNC_GROUP, 0, true);
+    if (followerSocket == INVALID_BLUFX_SOCKET || masterSocket == INVALID_BLUFX_SOCKET)
+    {
+        CHECK(!"unable to join the sync multicast group");
+        return;
+    }
+    sockaddr_in address;
+    socklen_t addressLength = sizeof(address);
+    getsockname(followerSocket, (sockaddr *) &address, &addressLength);
+    int port = ntohs(address.sin_port);
+
+    BLUfxParamReceiver receiver;
+    ResetParamReceiver(&receiver, &mailbox, TEST_PARAMS, &logQueue, "test: ");
+    std::atomic<bool> running(true);
+    std::thread receiveThread(ReceiveParamMessages, followerSocket, &receiver, &running);
+
+    float values[REMOTE_MAX_PARAMS] = {0.0f}, received[REMOTE_MAX_PARAMS] = {0.0f};
+    unsigned char buffer[REMOTE_MESSAGE_MAX_SIZE];
+    for (int i = 0; i < TEST_PARAMS; i++)
+        values[i] = 0.1f * i;
+
+    // the first message is a keyframe with all parameters
+    BLUfxSyncMaster master;
+    ResetSyncMaster(&master, values, TEST_PARAMS, SyncSequenceSeed());
+    int length = SyncMasterMessage(&master, values, 0.0f, buffer);
+    SendSyncMessage(masterSocket, TEST_SYNC_GROUP, port, buffer, length);
+    unsigned int mask = WaitForMailbox(received);
+    CHECK(mask == (1u << TEST_PARAMS) - 1);
+    CHECK(memcmp(received, values, TEST_PARAMS * sizeof(float)) == 0);
+
+    // then only changes, and nothing until the next heartbeat is due
+    values[TEST_SATURATION] = 1.3f;
+    length = SyncMasterMessage(&master, values, 0.0f, buffer);
+    SendSyncMessage(masterSocket, TEST_SYNC_GROUP, port, buffer, length);
+    mask = WaitForMailbox(received);
+    CHECK(mask == (1u << TEST_SATURATION));
+    CHECK(received[TEST_SATURATION] == 1.3f);
+    CHECK(SyncMasterMessage(&master, values, SYNC_HEARTBEAT_INTERVAL / 2.0f, buffer) == 0);
+
+    // a master restarted after fewer messages than the sequence window is ahead of its last run (as long as it sent at
+    // most one per ms, here 1000 fps), so its first message isn't dropped as stale
+    uint32_t firstSequence = SyncSequenceSeed();
+    ResetSyncMaster(&master, values, TEST_PARAMS, firstSequence);
+    int frames = REMOTE_SEQUENCE_WINDOW / 2;
+    for (int i = 0; i < frames; i++)
+    {
+        values[TEST_BRIGHTNESS] = 0.001f * i;
+        length = SyncMasterMessage(&master, values, 0.001f, buffer);
+    }
+    SendSyncMessage(masterSocket, TEST_SYNC_GROUP, port, buffer, length);    // only the last one, as if the rest was lost
+    mask = WaitForMailbox(received);
+    CHECK(mask == (1u << TEST_BRIGHTNESS));
+    values[TEST_CONTRAST] = 1.2f;
+    ResetSyncMaster(&master, values, TEST_PARAMS, firstSequence + frames);
+    length = SyncMasterMessage(&master, values, 0.0f, buffer);
+    SendSyncMessage(masterSocket, TEST_SYNC_GROUP, port, buffer, length);
+    mask = WaitForMailbox(received);
+    CHECK(mask == (1u << TEST_PARAMS) - 1);
+    CHECK(received[TEST_CONTRAST] == 1.2f);
+
+    // and the seed follows the wall clock
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK((int32_t) (SyncSequenceSeed() - firstSequence) >= 20);
+
+    running.store(false);
+    receiveThread.join();
+    CHECK(receiver.lastSequence == firstSequence + frames);
+    CloseSocket(masterSocket);
+    CloseSocket(followerSocket);
+}
+
+int main(int argc, char **argv)
+{
+    InitLog(&logQueue, LOG_ERROR);
+
+    TestRemoteControl(argc > 1 ? argv[1] : NULL);
+    TestGradeSync();
+
+    // what the receivers logged (errors only) helps to tell why a check failed
+    static char batch[LOG_QUEUE_SIZE * LOG_RECORD_SIZE + 1];
+    uint32_t dropped = 0;
+    if (DrainLog(&logQueue, batch, &dropped) > 0)
+        fprintf(stderr, "%s", batch);
+
+    if (failures == 0)
+        printf("remote control and grade sync: all checks passed\n");
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,394 @@
+/* Copyright (C) 2024  Steve Goldberg
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// test of the immediate-mode UI of the settings window (blu_fx_ui.h), runs headless without X-Plane:
+//
+//   blu_fx_ui_test
+//
+// checks the font atlas, the vertices the UI functions add and how the widgets handle the mouse and the keys; when
+// built with BLU_FX_UI_TEST_EGL, also draws a window offscreen (EGL pbuffer) the way the plugin does and checks some
+// pixels, which is skipped if no EGL display is available; exits with 1 if a check fails
+
+#include "blu_fx_ui.h"
+
+#ifdef BLU_FX_UI_TEST_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#endif
+
+#include <stdlib.h>
+
+// window of the tests, in boxels (and in pixels for the offscreen draw)
+#define TEST_WIDTH 200
+#define TEST_HEIGHT 100
+
+static int failures = 0;
+
+#define CHECK(condition) ((condition) ? (void) 0 : (void) (failures++, fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition)))
+
+// returns the alpha of the atlas texel at (x, y) of a glyph cell
+static int AtlasAlpha(const unsigned char *atlas, int glyph, int x, int y)
+{
+    int cellX = (glyph % UI_ATLAS_COLUMNS) * UI_ATLAS_CELL, cellY = (glyph / UI_ATLAS_COLUMNS) * UI_ATLAS_CELL;
+    return atlas[((cellY + y) * UI_ATLAS_WIDTH + cellX + x) * 4 + 3];
+}
+
+// checks the glyphs and the solid cell of the font atlas
+static void TestFontAtlas(void)
+{
+    static unsigned char atlas[UI_ATLAS_WIDTH * UI_ATLAS_HEIGHT * 4];
+    UiBuildFontAtlas(atlas);
+
+    bool white = true, solid = true, space = true;
+    for (int i = 0; i < UI_ATLAS_WIDTH * UI_ATLAS_HEIGHT; i++)
+        white = white && atlas[i * 4] == 255 && atlas[i * 4 + 1] == 255 && atlas[i * 4 + 2] == 255;
+    for (int y = 0; y < UI_ATLAS_CELL; y++)
+    {
+        for (int x = 0; x < UI_ATLAS_CELL; x++)
+        {
+            solid = solid && AtlasAlpha(atlas, UI_SOLID_CELL, x, y) == 255;
+            space = space && AtlasAlpha(atlas, ' ' - UI_FONT_FIRST, x, y) == 0;
+        }
+    }
+    CHECK(white);
+    CHECK(solid);
+    CHECK(space);
+
+    // the rows of 'A' as in the font table, with nothing outside of the glyph
+    bool matches = true;
+    int glyph = 'A' - UI_FONT_FIRST;
+    for (int y = 0; y < UI_ATLAS_CELL; y++)
+    {
+        for (int x = 0; x < UI_ATLAS_CELL; x++)
+        {
+            bool set = y < UI_GLYPH_HEIGHT && x < UI_GLYPH_WIDTH && (BLUfxUiFont[glyph][y] & (0x10 >> x));
+            matches = matches && AtlasAlpha(atlas, glyph, x, y) == (set ? 255 : 0);
+        }
+    }
+    CHECK(matches);
+    CHECK(AtlasAlpha(atlas, glyph, 0, 0) == 0 && AtlasAlpha(atlas, glyph, 1, 0) == 255);
+}
+
+// checks the vertices of the background, a text and a rectangle
+static void TestVertices(void)
+{
+    BLUfxUi ui = BLUfxUi();
+    UiBegin(&ui, 0, TEST_HEIGHT, TEST_WIDTH, 0);
+    CHECK(ui.vertices.size() == 6);
+    CHECK(ui.vertices[0].x == 0.0f && ui.vertices[0].y == TEST_HEIGHT && ui.vertices[2].x == TEST_WIDTH && ui.vertices[2].y == 0.0f);
+    CHECK(ui.vertices[0].color == UI_COLOR_BACKGROUND);
+    CHECK(ui.y == TEST_HEIGHT - UI_PADDING);
+
+    // one quad per glyph, none for a space; the top left of 'A' maps to the top left of its cell
+    UiText(&ui, 10.0f, 50.0f, "A B", UI_COLOR_TEXT);
+    CHECK(ui.vertices.size() == 18);
+    const BLUfxUiVertex *a = &ui.vertices[6];
+    CHECK(a->x == 10.0f && a->y == 50.0f);
+    CHECK(a->u == (float) (('A' - UI_FONT_FIRST) % UI_ATLAS_COLUMNS * UI_ATLAS_CELL) / UI_ATLAS_WIDTH);
+    CHECK(a->v == (float) (('A' - UI_FONT_FIRST) / UI_ATLAS_COLUMNS * UI_ATLAS_CELL) / UI_ATLAS_HEIGHT);
+    CHECK(ui.vertices[8].x == 10.0f + UI_GLYPH_WIDTH * UI_SCALE && ui.vertices[8].y == 50.0f - UI_TEXT_HEIGHT);
+    CHECK(ui.vertices[12].x == 10.0f + 2 * UI_CHAR_ADVANCE);
+    CHECK(UiTextWidth("A B") == 3 * UI_CHAR_ADVANCE - UI_SCALE && UiTextWidth("") == 0);
+
+    // rectangles sample the solid cell only
+    UiRect(&ui, 0.0f, 0.0f, 10.0f, 10.0f, UI_COLOR_LINE);
+    CHECK(ui.vertices.size() == 24);
+    CHECK(ui.vertices[18].u == ui.vertices[20].u && ui.vertices[18].v == ui.vertices[20].v);
+    CHECK(ui.vertices[18].u * UI_ATLAS_WIDTH == (UI_SOLID_CELL % UI_ATLAS_COLUMNS) * UI_ATLAS_CELL + UI_ATLAS_CELL / 2);
+
+    // images go into their own list
+    UiImage(&ui, 0.0f, 0.0f, 10.0f, 10.0f, 0.0f, 0.0f, 1.0f, 1.0f);
+    CHECK(ui.vertices.size() == 24 && ui.images.size() == 6);
+
+    // a header is its text and a line below it, and takes a row and a bit
+    int y = ui.y;
+    UiHeader(&ui, "AB");
+    CHECK(ui.vertices.size() == 24 + 3 * 6);
+    CHECK(ui.y == y - UI_ROW_HEIGHT - 4);
+    UiEnd(&ui);
+}
+
+// state of the test window, described again each frame like the settings window
+struct TestWindow_t
+{
+    BLUfxUi ui;
+    bool enabled;
+    int clicks, disabledClicks, checked, position;
+    char text[8];
+};
+typedef TestWindow_t TestWindow;
+
+// describes a frame of the test window: a button, a disabled button, a checkbox, a slider and a text field, each in
+// its own row of [10, 110]
+static void TestWindowFrame(TestWindow *window)
+{
+    BLUfxUi *ui = &window->ui;
+    UiBegin(ui, 0, TEST_HEIGHT * 2, TEST_WIDTH, 0);
+    if (UiButton(ui, 10, 110, "Button"))
+        window->clicks++;
+    UiNextRow(ui);
+    if (UiButton(ui, 10, 110, "Disabled", false))
+        window->disabledClicks++;
+    UiNextRow(ui);
+    UiCheckbox(ui, 10, "Check", &window->checked);
+    UiNextRow(ui);
+    UiSlider(ui, 10, 110, &window->position, 0, 100);
+    UiNextRow(ui);
+    UiTextField(ui, 10, 110, window->text, sizeof(window->text));
+    UiNextRow(ui);
+    UiEnd(ui);
+}
+
+// center of the item in the given row of the test window
+static int RowY(int row)
+{
+    return TEST_HEIGHT * 2 - UI_PADDING - row * UI_ROW_HEIGHT - UI_ITEM_HEIGHT / 2;
+}
+
+// moves the mouse and describes the next frame, as the plugin does from its mouse handlers
+static void Mouse(TestWindow *window, int x, int y, int pressed, int released)
+{
+    window->ui.mouseX = x;
+    window->ui.mouseY = y;
+    window->ui.mouseDown = (window->ui.mouseDown || pressed) && !released;
+    window->ui.mousePressed = pressed;
+    window->ui.mouseReleased = released;
+    TestWindowFrame(window);
+}
+
+// checks that the widgets react to the mouse and the keys only where and when they should
+static void TestHitTesting(void)
+{
+    TestWindow window = TestWindow();
+    TestWindowFrame(&window);
+
+    // a click is a press and a release on the button
+    Mouse(&window, 50, RowY(0), 1, 0);
+    CHECK(window.clicks == 0);
+    Mouse(&window, 50, RowY(0), 0, 1);
+    CHECK(window.clicks == 1);
+    Mouse(&window, 50, RowY(0), 1, 0);
+    Mouse(&window, 150, RowY(0), 0, 1);
+    CHECK(window.clicks == 1);
+    Mouse(&window, 150, RowY(0), 1, 0);
+    Mouse(&window, 50, RowY(0), 0, 1);
+    CHECK(window.clicks == 1);
+    Mouse(&window, 50, RowY(0) + UI_ITEM_HEIGHT, 1, 0);
+    Mouse(&window, 50, RowY(0) + UI_ITEM_HEIGHT, 0, 1);
+    CHECK(window.clicks == 1);
+
+    // a disabled button is never clicked
+    Mouse(&window, 50, RowY(1), 1, 0);
+    Mouse(&window, 50, RowY(1), 0, 1);
+    CHECK(window.disabledClicks == 0);
+
+    // the checkbox toggles on its box and its label
+    Mouse(&window, 12, RowY(2), 1, 0);
+    Mouse(&window, 12, RowY(2), 0, 1);
+    CHECK(window.checked == 1);
+    Mouse(&window, 10 + UI_ITEM_HEIGHT + UiTextWidth("Check") / 2, RowY(2), 1, 0);
+    Mouse(&window, 10 + UI_ITEM_HEIGHT + UiTextWidth("Check") / 2, RowY(2), 0, 1);
+    CHECK(window.checked == 0);
+
+    // the slider follows the mouse while held, also beyond its ends, and stays when released
+    Mouse(&window, 60, RowY(3), 1, 0);
+    CHECK(window.position == 50);
+    Mouse(&window, 500, RowY(0), 0, 0);
+    CHECK(window.position == 100);
+    Mouse(&window, 500, RowY(0), 0, 1);
+    Mouse(&window, 10, RowY(3), 0, 0);
+    CHECK(window.position == 100);
+
+    // keys only go to the text field while it has the focus, which a click elsewhere or return take away
+    UiTypeKey(&window.ui, 'x');
+    TestWindowFrame(&window);
+    CHECK(window.text[0] == '\0');
+    Mouse(&window, 50, RowY(4), 1, 0);
+    Mouse(&window, 50, RowY(4), 0, 1);
+    CHECK(window.ui.focusedId != 0);
+    const char *typed = "abcdefghij";
+    for (const char *c = typed; *c != '\0'; c++)
+        UiTypeKey(&window.ui, *c);
+    UiTypeKey(&window.ui, '\t');
+    TestWindowFrame(&window);
+    CHECK(strcmp(window.text, "abcdefg") == 0);
+    UiTypeKey(&window.ui, UI_KEY_BACKSPACE);
+    UiTypeKey(&window.ui, UI_KEY_BACKSPACE);
+    UiTypeKey(&window.ui, 'z');
+    TestWindowFrame(&window);
+    CHECK(strcmp(window.text, "abcdez") == 0);
+    Mouse(&window, 150, RowY(0), 1, 0);
+    CHECK(window.ui.focusedId == 0);
+    Mouse(&window, 150, RowY(0), 0, 1);
+    Mouse(&window, 50, RowY(4), 1, 0);
+    Mouse(&window, 50, RowY(4), 0, 1);
+    UiTypeKey(&window.ui, UI_KEY_RETURN);
+    UiTypeKey(&window.ui, 'q');
+    TestWindowFrame(&window);
+    CHECK(window.ui.focusedId == 0 && strcmp(window.text, "abcdez") == 0);
+}
+
+// checks that a thumbnail tile is clicked like a button, unless it is the selected one, and puts its image into the image
+// list
+static void TestImageButton(void)
+{
+    BLUfxUi ui = BLUfxUi();
+    int clicks = 0;
+    for (int frame = 0; frame < 4; frame++)
+    {
+        // press and release on the tile, unselected in the first two frames and selected in the other two
+        ui.mouseX = 50;
+        ui.mouseY = TEST_HEIGHT - UI_PADDING - 20;
+        ui.mouseDown = ui.mousePressed = (frame % 2 == 0);
+        ui.mouseReleased = (frame % 2 == 1);
+        UiBegin(&ui, 0, TEST_HEIGHT, TEST_WIDTH, 0);
+        if (UiImageButton(&ui, 10, 110, 60, "Tile", frame >= 2, 0.0f, 0.0f, 0.5f, 0.5f))
+            clicks++;
+        CHECK(ui.images.size() == 6);
+        CHECK(ui.images[2].u == 0.5f && ui.images[2].v == 0.0f);
+        UiEnd(&ui);
+    }
+    CHECK(clicks == 1);
+}
+
+#ifdef BLU_FX_UI_TEST_EGL
+// returns whether the pixel at (x, y) is within 2 of a color
+static bool PixelIs(int x, int y, unsigned int color)
+{
+    unsigned char pixel[4];
+    glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+    for (int i = 0; i < 3; i++)
+    {
+        if (abs(pixel[i] - (int) ((color >> (8 * i)) & 0xff)) > 2)
+        {
+            fprintf(stderr, "pixel (%d, %d) is %d, %d, %d, expected %d, %d, %d\n", x, y, pixel[0], pixel[1], pixel[2], color & 0xff, (color >> 8) & 0xff, (color >> 16) & 0xff);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// draws a window with a button offscreen like DrawSettingsWindow (one boxel per pixel) and checks the background, the
+// button and its label
+static void TestOffscreenDraw(void)
+{
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay display = (getPlatformDisplay != NULL ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL) : EGL_NO_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+    {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+        {
+            printf("offscreen draw: skipped, no EGL display\n");
+            return;
+        }
+    }
+
+    const EGLint configAttributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8, EGL_NONE};
+    const EGLint surfaceAttributes[] = {EGL_WIDTH, TEST_WIDTH, EGL_HEIGHT, TEST_HEIGHT, EGL_NONE};
+    EGLConfig config;
+    EGLint configCount = 0;
+    EGLSurface surface = EGL_NO_SURFACE;
+    EGLContext context = EGL_NO_CONTEXT;
+    if (eglChooseConfig(display, configAttributes, &config, 1, &configCount) && configCount > 0 && eglBindAPI(EGL_OPENGL_API))
+    {
+        surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+    }
+    if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context))
+    {
+        printf("offscreen draw: skipped, no OpenGL context\n");
+        eglTerminate(display);
+        return;
+    }
+
+    static unsigned char atlas[UI_ATLAS_WIDTH * UI_ATLAS_HEIGHT * 4];
+    UiBuildFontAtlas(atlas);
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, UI_ATLAS_WIDTH, UI_ATLAS_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, atlas);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // the window, with a button "A" in [10, 110] of the first row (the mouse is outside of it)
+    BLUfxUi ui = BLUfxUi();
+    ui.mouseX = ui.mouseY = -1;
+    UiBegin(&ui, 0, TEST_HEIGHT, TEST_WIDTH, 0);
+    UiButton(&ui, 10, 110, "A");
+    UiEnd(&ui);
+
+    // the graphics state of XPLMSetGraphicsState(0, 1, 0, 1, 1, 0, 0) in window coordinates
+    glViewport(0, 0, TEST_WIDTH, TEST_HEIGHT);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(0.0, TEST_WIDTH, 0.0, TEST_HEIGHT, -1.0, 1.0);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glEnable(GL_TEXTURE_2D);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    const BLUfxUiVertex *vertices = ui.vertices.data();
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, sizeof(BLUfxUiVertex), &vertices->x);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(BLUfxUiVertex), &vertices->u);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(BLUfxUiVertex), &vertices->color);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei) ui.vertices.size());
+    glFinish();
+    CHECK(glGetError() == GL_NO_ERROR);
+
+    // the background is blended over black; the label is centered in the button, its top row is .###.
+    int labelX = 10 + (100 - UiTextWidth("A")) / 2, labelTop = TEST_HEIGHT - UI_PADDING - (UI_ITEM_HEIGHT - UI_TEXT_HEIGHT) / 2;
+    CHECK(PixelIs(TEST_WIDTH - 5, 5, UI_RGBA(25 * 235 / 255, 28 * 235 / 255, 34 * 235 / 255, 255)));
+    CHECK(PixelIs(12, TEST_HEIGHT - UI_PADDING - UI_ITEM_HEIGHT + 2, UI_COLOR_ITEM));
+    CHECK(PixelIs(labelX + UI_SCALE / 2, labelTop - 1, UI_COLOR_ITEM));
+    CHECK(PixelIs(labelX + UI_SCALE + UI_SCALE / 2, labelTop - 1, UI_COLOR_TEXT));
+    CHECK(PixelIs(labelX + UI_SCALE / 2, labelTop - UI_SCALE - 1, UI_COLOR_TEXT));
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDeleteTextures(1, &texture);
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglDestroySurface(display, surface);
+    eglTerminate(display);
+}
+#endif
+
+int main(void)
+{
+    TestFontAtlas();
+    TestVertices();
+    TestHitTesting();
+    TestImageButton();
+#ifdef BLU_FX_UI_TEST_EGL
+    TestOffscreenDraw();
+#endif
+
+    if (failures == 0)
+        printf("settings window UI: all checks passed\n");
+
+    return failures == 0 ? 0 : 1;
+}